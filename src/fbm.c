@@ -0,0 +1,405 @@
+// fbm
+//
+// Fractal sums (fBm) of classic and simplex Perlin noise.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "fbm.h" for a description. This file needs "noise1234.c",
+ * "simplexnoise1234.c" and "sdnoise1234.c" to be compiled and linked
+ * with it.
+ *
+ * The octave frequencies and amplitudes are accumulated by repeated
+ * multiplication in the same way in every function here, so the bounds
+ * are computed for exactly the same scaled coordinates as the sums.
+ */
+
+#include "noise1234.h"
+#include "simplexnoise1234.h"
+#include "sdnoise1234.h"
+#include "fbm.h"
+
+//---------------------------------------------------------------------
+/** 2D fractal sum of classic Perlin noise.
+ */
+float fbm2( float x, float y, int octaves, float lacunarity, float gain )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * noise2( x * freq, y * freq );
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** 2D fractal sum of simplex noise.
+ */
+float sfbm2( float x, float y, int octaves, float lacunarity, float gain )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * snoise2( x * freq, y * freq );
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** 3D fractal sum of classic Perlin noise.
+ */
+float fbm3( float x, float y, float z,
+            int octaves, float lacunarity, float gain )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * noise3( x * freq, y * freq, z * freq );
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** 3D fractal sum of simplex noise.
+ */
+float sfbm3( float x, float y, float z,
+             int octaves, float lacunarity, float gain )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * snoise3( x * freq, y * freq, z * freq );
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** 3D fractal sum of simplex noise, with analytic derivative.
+ */
+float sdfbm3( float x, float y, float z,
+              int octaves, float lacunarity, float gain,
+              float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    float gx = 0.0f, gy = 0.0f, gz = 0.0f, dx, dy, dz;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * sdnoise3( x * freq, y * freq, z * freq, &dx, &dy, &dz );
+        gx += amp * freq * dx; // Chain rule for the scaled coordinates
+        gy += amp * freq * dy;
+        gz += amp * freq * dz;
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    if( dnoise_dx && dnoise_dy && dnoise_dz ) {
+        *dnoise_dx = gx;
+        *dnoise_dy = gy;
+        *dnoise_dz = gz;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** 3D fractal sum of simplex noise over arrays of points, without
+ * derivatives. The octaves are evaluated with sdnoise3_batch() over
+ * blocks of FBM_BLOCK points, in the same order as in sdfbm3().
+ */
+
+#define FBM_BLOCK 64
+
+void sdfbm3_batch( int n, const float *x, const float *y, const float *z,
+                   int octaves, float lacunarity, float gain, float *result )
+{
+    float px[FBM_BLOCK], py[FBM_BLOCK], pz[FBM_BLOCK], v[FBM_BLOCK];
+    int i0, m, i, o;
+
+    for( i0 = 0; i0 < n; i0 += FBM_BLOCK ) {
+        float freq = 1.0f, amp = 1.0f;
+        m = ( n - i0 < FBM_BLOCK ) ? n - i0 : FBM_BLOCK;
+        for( i = 0; i < m; i++ ) result[i0 + i] = 0.0f;
+        for( o = 0; o < octaves; o++ ) {
+            for( i = 0; i < m; i++ ) {
+                px[i] = x[i0 + i] * freq;
+                py[i] = y[i0 + i] * freq;
+                pz[i] = z[i0 + i] * freq;
+            }
+            sdnoise3_batch( m, px, py, pz, v, 0, 0, 0 );
+            for( i = 0; i < m; i++ ) result[i0 + i] += amp * v[i];
+            freq *= lacunarity;
+            amp *= gain;
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+typedef void (*bounds3func)( float x0, float y0, float z0,
+                             float x1, float y1, float z1,
+                             float *nmin, float *nmax );
+
+// Sum the per-octave bounds, each scaled by its (possibly negative) amplitude
+static void fbm3_bounds_sum( bounds3func bounds,
+                             float x0, float y0, float z0,
+                             float x1, float y1, float z1,
+                             int octaves, float lacunarity, float gain,
+                             float *nmin, float *nmax )
+{
+    float lo = 0.0f, hi = 0.0f, freq = 1.0f, amp = 1.0f;
+    float omin, omax;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        bounds( x0 * freq, y0 * freq, z0 * freq,
+                x1 * freq, y1 * freq, z1 * freq, &omin, &omax );
+        if( amp >= 0.0f ) {
+            lo += amp * omin;
+            hi += amp * omax;
+        } else {
+            lo += amp * omax;
+            hi += amp * omin;
+        }
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    *nmin = lo;
+    *nmax = hi;
+}
+
+/** Guaranteed bounds for fbm3() over a box.
+ */
+void fbm3_bounds( float x0, float y0, float z0,
+                  float x1, float y1, float z1,
+                  int octaves, float lacunarity, float gain,
+                  float *nmin, float *nmax )
+{
+    fbm3_bounds_sum( noise3_bounds, x0, y0, z0, x1, y1, z1,
+                     octaves, lacunarity, gain, nmin, nmax );
+}
+
+/** Guaranteed bounds for sfbm3() over a box.
+ */
+void sfbm3_bounds( float x0, float y0, float z0,
+                   float x1, float y1, float z1,
+                   int octaves, float lacunarity, float gain,
+                   float *nmin, float *nmax )
+{
+    fbm3_bounds_sum( snoise3_bounds, x0, y0, z0, x1, y1, z1,
+                     octaves, lacunarity, gain, nmin, nmax );
+}
+
+//---------------------------------------------------------------------
+
+/*
+ * Threshold queries. After each octave, the octaves that remain can
+ * change the sum by at most the sum of their amplitudes times the largest
+ * magnitude of one octave. If that cannot bring the sum across the
+ * threshold, the answer is known and the remaining octaves are skipped.
+ * The default magnitudes are the provable global bounds that are also
+ * used by noise3_bounds() and snoise3_bounds(). See "fbm.h" for the
+ * faster empirical bound FBM_OCTAVE_BOUND.
+ */
+
+#ifdef FBM_OCTAVE_BOUND
+#define NOISE3_OCTAVE_BOUND FBM_OCTAVE_BOUND
+#define SNOISE3_OCTAVE_BOUND FBM_OCTAVE_BOUND
+#else
+#define NOISE3_OCTAVE_BOUND 1.872f  // 0.936 times the largest ramp, 2
+#define SNOISE3_OCTAVE_BOUND 3.746f // 72 times four terms of 0.013
+#endif
+
+typedef float (*noise3func)( float x, float y, float z );
+
+static int fbm3_above_sum( noise3func noise, float bound,
+                           float x, float y, float z,
+                           int octaves, float lacunarity, float gain,
+                           float iso, int *octaves_used )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f, rest = 0.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) { // Largest possible sum of all octaves
+        rest += ( amp < 0.0f ) ? -amp : amp;
+        amp *= gain;
+    }
+    rest *= bound;
+
+    amp = 1.0f;
+    for( o = 0; o < octaves; o++ ) {
+        sum += amp * noise( x * freq, y * freq, z * freq );
+        rest -= bound * ( ( amp < 0.0f ) ? -amp : amp );
+        freq *= lacunarity;
+        amp *= gain;
+        if( sum - rest > iso || sum + rest <= iso ) {
+            o++;
+            break;
+        }
+    }
+    if( octaves_used ) *octaves_used = o;
+    return sum > iso;
+}
+
+/** Threshold query fbm3( x, y, z, ... ) > iso, with early termination.
+ */
+int fbm3_above( float x, float y, float z,
+                int octaves, float lacunarity, float gain,
+                float iso, int *octaves_used )
+{
+    return fbm3_above_sum( noise3, NOISE3_OCTAVE_BOUND, x, y, z,
+                           octaves, lacunarity, gain, iso, octaves_used );
+}
+
+/** Threshold query sfbm3( x, y, z, ... ) > iso, with early termination.
+ */
+int sfbm3_above( float x, float y, float z,
+                 int octaves, float lacunarity, float gain,
+                 float iso, int *octaves_used )
+{
+    return fbm3_above_sum( snoise3, SNOISE3_OCTAVE_BOUND, x, y, z,
+                           octaves, lacunarity, gain, iso, octaves_used );
+}
+
+/** Threshold queries over arrays of n points.
+ */
+void fbm3_above_batch( int n, const float *x, const float *y, const float *z,
+                       int octaves, float lacunarity, float gain, float iso,
+                       int *result, int *octaves_used )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = fbm3_above_sum( noise3, NOISE3_OCTAVE_BOUND,
+                                    x[i], y[i], z[i],
+                                    octaves, lacunarity, gain, iso,
+                                    octaves_used ? octaves_used + i : 0 );
+}
+
+void sfbm3_above_batch( int n, const float *x, const float *y, const float *z,
+                        int octaves, float lacunarity, float gain, float iso,
+                        int *result, int *octaves_used )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = fbm3_above_sum( snoise3, SNOISE3_OCTAVE_BOUND,
+                                    x[i], y[i], z[i],
+                                    octaves, lacunarity, gain, iso,
+                                    octaves_used ? octaves_used + i : 0 );
+}
+
+//---------------------------------------------------------------------
+/** 2D fractal sums over arrays of points.
+ */
+void fbm2_batch( int n, const float *x, const float *y,
+                 int octaves, float lacunarity, float gain, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = fbm2( x[i], y[i], octaves, lacunarity, gain );
+}
+
+void sfbm2_batch( int n, const float *x, const float *y,
+                  int octaves, float lacunarity, float gain, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = sfbm2( x[i], y[i], octaves, lacunarity, gain );
+}
+
+//---------------------------------------------------------------------
+
+// Weight of an octave for antialiasing, from the filter width measured in
+// units of the noise lattice at that octave. The noise has most of its
+// energy near one cycle per lattice unit, so octaves are kept in full up
+// to FBM_LOD_FULL, faded out with a smoothstep up to FBM_LOD_CUT, and
+// skipped beyond that.
+static float lod_weight( float w )
+{
+    if( w <= FBM_LOD_FULL ) return 1.0f;
+    if( w >= FBM_LOD_CUT ) return 0.0f;
+    w = ( FBM_LOD_CUT - w ) / ( FBM_LOD_CUT - FBM_LOD_FULL );
+    return w * w * ( 3.0f - 2.0f * w );
+}
+
+typedef float (*noise2func)( float x, float y );
+
+static float fbm2_lod_sum( noise2func noise, float x, float y,
+                           int octaves, float lacunarity, float gain,
+                           float filterwidth )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f, w;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        w = lod_weight( filterwidth * freq );
+        if( w > 0.0f )
+            sum += w * amp * noise( x * freq, y * freq );
+        else if( lacunarity >= 1.0f )
+            break; // All remaining octaves are finer still
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+static float fbm3_lod_sum( noise3func noise, float x, float y, float z,
+                           int octaves, float lacunarity, float gain,
+                           float filterwidth )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f, w;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        w = lod_weight( filterwidth * freq );
+        if( w > 0.0f )
+            sum += w * amp * noise( x * freq, y * freq, z * freq );
+        else if( lacunarity >= 1.0f )
+            break;
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return sum;
+}
+
+/** Band-limited fractal sums for a given filter width.
+ */
+float fbm2_lod( float x, float y, int octaves, float lacunarity, float gain,
+                float filterwidth )
+{
+    return fbm2_lod_sum( noise2, x, y, octaves, lacunarity, gain,
+                         filterwidth );
+}
+
+float sfbm2_lod( float x, float y, int octaves, float lacunarity, float gain,
+                 float filterwidth )
+{
+    return fbm2_lod_sum( snoise2, x, y, octaves, lacunarity, gain,
+                         filterwidth );
+}
+
+float fbm3_lod( float x, float y, float z,
+                int octaves, float lacunarity, float gain, float filterwidth )
+{
+    return fbm3_lod_sum( noise3, x, y, z, octaves, lacunarity, gain,
+                         filterwidth );
+}
+
+float sfbm3_lod( float x, float y, float z,
+                 int octaves, float lacunarity, float gain, float filterwidth )
+{
+    return fbm3_lod_sum( snoise3, x, y, z, octaves, lacunarity, gain,
+                         filterwidth );
+}
+
+//---------------------------------------------------------------------
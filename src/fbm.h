@@ -0,0 +1,132 @@
+// fbm
+//
+// Fractal sums (fBm) of classic and simplex Perlin noise.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * All functions here compute the same sum of octaves:
+ *
+ *   fbm(p) = sum for o = 0 .. octaves-1 of gain^o * noise(lacunarity^o * p)
+ *
+ * where noise() is noise2/noise3 from "noise1234.c" for the fbm*()
+ * functions, snoise2/snoise3 from "simplexnoise1234.c" for the sfbm*()
+ * functions and sdnoise2/sdnoise3 from "sdnoise1234.c" for the sdfbm*()
+ * functions. Typical values are lacunarity = 2.0 and gain = 0.5.
+ */
+
+/** 2D fractal sum of classic and simplex noise.
+ */
+extern float fbm2( float x, float y,
+                   int octaves, float lacunarity, float gain );
+extern float sfbm2( float x, float y,
+                    int octaves, float lacunarity, float gain );
+
+/** 3D fractal sum of classic and simplex noise.
+ */
+extern float fbm3( float x, float y, float z,
+                   int octaves, float lacunarity, float gain );
+extern float sfbm3( float x, float y, float z,
+                    int octaves, float lacunarity, float gain );
+
+/** 3D fractal sum of simplex noise with derivatives.
+ * If the last three arguments are not null, the analytic derivative
+ * (the 3D gradient of the fractal sum) is also calculated.
+ */
+extern float sdfbm3( float x, float y, float z,
+                     int octaves, float lacunarity, float gain,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+
+/** sdfbm3() without derivatives over arrays of n points: result[i] is
+ * the fractal sum at (x[i], y[i], z[i]). The octaves are evaluated over
+ * blocks of points with sdnoise3_batch(), which is much faster than
+ * calling sdfbm3() for each point.
+ */
+extern void sdfbm3_batch( int n, const float *x, const float *y,
+                          const float *z,
+                          int octaves, float lacunarity, float gain,
+                          float *result );
+
+/** Guaranteed lower and upper bounds for fbm3() and sfbm3() over the
+ * axis-aligned box [x0,x1]x[y0,y1]x[z0,z1], from the per-octave bounds
+ * of noise3_bounds() and snoise3_bounds(). The bounds are conservative,
+ * and they get looser for the octaves where the box covers many cells.
+ */
+extern void fbm3_bounds( float x0, float y0, float z0,
+                         float x1, float y1, float z1,
+                         int octaves, float lacunarity, float gain,
+                         float *nmin, float *nmax );
+extern void sfbm3_bounds( float x0, float y0, float z0,
+                          float x1, float y1, float z1,
+                          int octaves, float lacunarity, float gain,
+                          float *nmin, float *nmax );
+
+/** Threshold queries: returns 1 if fbm3() or sfbm3() at (x,y,z) is
+ * greater than iso, and 0 otherwise. The octaves are summed in order,
+ * and the sum stops as soon as the remaining octaves can no longer
+ * change the answer, judged by a bound on the magnitude of one octave.
+ * If octaves_used is not null, the number of octaves that were actually
+ * evaluated is stored there.
+ *
+ * By default, the provable bounds 1.872 for noise3() and 3.746 for
+ * snoise3() are used, and the answer is the same as from comparing the
+ * full sum, up to rounding in the sum. The largest values seen in
+ * practice are close to 0.96 and 0.94, and compiling "fbm.c" with
+ * -DFBM_OCTAVE_BOUND=1.0f stops much earlier, but that bound is
+ * empirical and not guaranteed.
+ */
+extern int fbm3_above( float x, float y, float z,
+                       int octaves, float lacunarity, float gain,
+                       float iso, int *octaves_used );
+extern int sfbm3_above( float x, float y, float z,
+                        int octaves, float lacunarity, float gain,
+                        float iso, int *octaves_used );
+
+/** Threshold queries over arrays of n points. result[i] is set to the
+ * answer for point i, and if octaves_used is not null, octaves_used[i]
+ * is set to the number of octaves evaluated for that point.
+ */
+extern void fbm3_above_batch( int n, const float *x, const float *y,
+                              const float *z,
+                              int octaves, float lacunarity, float gain,
+                              float iso, int *result, int *octaves_used );
+extern void sfbm3_above_batch( int n, const float *x, const float *y,
+                               const float *z,
+                               int octaves, float lacunarity, float gain,
+                               float iso, int *result, int *octaves_used );
+
+/** 2D fractal sums over arrays of n points.
+ * result[i] is fbm2() or sfbm2() at (x[i], y[i]).
+ */
+extern void fbm2_batch( int n, const float *x, const float *y,
+                        int octaves, float lacunarity, float gain,
+                        float *result );
+extern void sfbm2_batch( int n, const float *x, const float *y,
+                         int octaves, float lacunarity, float gain,
+                         float *result );
+
+/** Band-limited fractal sums, for antialiased rendering and level of
+ * detail. filterwidth is the size of the area covered by one sample, such
+ * as a pixel footprint, in the same units as the coordinates. An octave
+ * where one sample covers up to FBM_LOD_FULL lattice units is summed in
+ * full, one where it covers FBM_LOD_CUT or more is skipped, and octaves
+ * in between are faded out smoothly. Octaves that are skipped are not
+ * evaluated, so the cost goes down with the level of detail. With
+ * filterwidth = 0, the result is the same as fbm2() etc.
+ */
+#define FBM_LOD_FULL 0.25f
+#define FBM_LOD_CUT 0.5f
+
+extern float fbm2_lod( float x, float y,
+                       int octaves, float lacunarity, float gain,
+                       float filterwidth );
+extern float sfbm2_lod( float x, float y,
+                        int octaves, float lacunarity, float gain,
+                        float filterwidth );
+extern float fbm3_lod( float x, float y, float z,
+                       int octaves, float lacunarity, float gain,
+                       float filterwidth );
+extern float sfbm3_lod( float x, float y, float z,
+                        int octaves, float lacunarity, float gain,
+                        float filterwidth );
@@ -25,6 +25,8 @@
  *
  */
 
+#include <stdlib.h>
+
 #include "noise1234.h"
 
 // This is the new and improved, C(2) continuous interpolant
@@ -54,7 +56,7 @@
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
  */
-unsigned char perm[] = {151,160,137,91,90,15,
+static unsigned char perm[] = {151,160,137,91,90,15,
   131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
   190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
   88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
@@ -102,28 +104,28 @@ unsigned char perm[] = {151,160,137,91,90,15,
  * float SLnoise = (noise3(x,y,z) + 1.0) * 0.5;
  */
 
-float grad1( int hash, float x ) {
+static float grad1( int hash, float x ) {
     int h = hash & 15;
     float grad = 1.0 + (h & 7);  // Gradient value 1.0, 2.0, ..., 8.0
     if (h&8) grad = -grad;         // and a random sign for the gradient
     return ( grad * x );           // Multiply the gradient with the distance
 }
 
-float grad2( int hash, float x, float y ) {
+static float grad2( int hash, float x, float y ) {
     int h = hash & 7;      // Convert low 3 bits of hash code
     float u = h<4 ? x : y;  // into 8 simple gradient directions,
     float v = h<4 ? y : x;  // and compute the dot product with (x,y).
     return ((h&1)? -u : u) + ((h&2)? -2.0*v : 2.0*v);
 }
 
-float grad3( int hash, float x, float y , float z ) {
+static float grad3( int hash, float x, float y , float z ) {
     int h = hash & 15;     // Convert low 4 bits of hash code into 12 simple
     float u = h<8 ? x : y; // gradient directions, and compute dot product.
     float v = h<4 ? y : h==12||h==14 ? x : z; // Fix repeats at h = 12 to 15
     return ((h&1)? -u : u) + ((h&2)? -v : v);
 }
 
-float grad4( int hash, float x, float y, float z, float t ) {
+static float grad4( int hash, float x, float y, float z, float t ) {
     int h = hash & 31;      // Convert low 5 bits of hash code into 32 simple
     float u = h<24 ? x : y; // gradient directions, and compute dot product.
     float v = h<16 ? y : z;
@@ -131,6 +133,52 @@ float grad4( int hash, float x, float y, float z, float t ) {
     return ((h&1)? -u : u) + ((h&2)? -v : v) + ((h&4)? -w : w);
 }
 
+// The gradient vectors that grad2(), grad3() and grad4() take the dot
+// product with, for each value of the hash bits they use
+static const signed char grad2vec[8][2] = {
+  { 1, 2}, {-1, 2}, { 1,-2}, {-1,-2}, { 2, 1}, { 2,-1}, {-2, 1}, {-2,-1} };
+static const signed char grad3vec[16][3] = {
+  { 1, 1, 0}, {-1, 1, 0}, { 1,-1, 0}, {-1,-1, 0},
+  { 1, 0, 1}, {-1, 0, 1}, { 1, 0,-1}, {-1, 0,-1},
+  { 0, 1, 1}, { 0,-1, 1}, { 0, 1,-1}, { 0,-1,-1},
+  { 1, 1, 0}, { 0,-1, 1}, {-1, 1, 0}, { 0,-1,-1} };
+static const signed char grad4vec[32][4] = {
+  { 1, 1, 1, 0}, {-1, 1, 1, 0}, { 1,-1, 1, 0}, {-1,-1, 1, 0},
+  { 1, 1,-1, 0}, {-1, 1,-1, 0}, { 1,-1,-1, 0}, {-1,-1,-1, 0},
+  { 1, 1, 0, 1}, {-1, 1, 0, 1}, { 1,-1, 0, 1}, {-1,-1, 0, 1},
+  { 1, 1, 0,-1}, {-1, 1, 0,-1}, { 1,-1, 0,-1}, {-1,-1, 0,-1},
+  { 1, 0, 1, 1}, {-1, 0, 1, 1}, { 1, 0,-1, 1}, {-1, 0,-1, 1},
+  { 1, 0, 1,-1}, {-1, 0, 1,-1}, { 1, 0,-1,-1}, {-1, 0,-1,-1},
+  { 0, 1, 1, 1}, { 0,-1, 1, 1}, { 0, 1,-1, 1}, { 0,-1,-1, 1},
+  { 0, 1, 1,-1}, { 0,-1, 1,-1}, { 0, 1,-1,-1}, { 0,-1,-1,-1} };
+
+// The same dot products as grad2(), grad3() and grad4(), but from the
+// tables above instead of with branches on the hash bits. The hashes are
+// random, so those branches are hard to predict, and this is a lot faster.
+// The results are identical: the terms are added in the same order, and
+// a zero component adds nothing.
+static float gdot2( int hash, float x, float y ) {
+    const signed char *g = grad2vec[hash & 7];
+    return g[0]*x + g[1]*y;
+}
+
+static float gdot3( int hash, float x, float y, float z ) {
+    const signed char *g = grad3vec[hash & 15];
+    return g[0]*x + g[1]*y + g[2]*z;
+}
+
+static float gdot4( int hash, float x, float y, float z, float t ) {
+    const signed char *g = grad4vec[hash & 31];
+    return g[0]*x + g[1]*y + g[2]*z + g[3]*t;
+}
+
+// Wrap a lattice coordinate to 0..p-1. The % operator rounds towards zero,
+// so a negative remainder is moved up by one period.
+static int pwrap( int i, int p ) {
+    i %= p;
+    return ( i < 0 ) ? i + p : i;
+}
+
 //---------------------------------------------------------------------
 /** 1D float Perlin noise, SL "noise()"
  */
@@ -165,8 +213,8 @@ float pnoise1( float x, int px )
     ix0 = FASTFLOOR( x ); // Integer part of x
     fx0 = x - ix0;       // Fractional part of x
     fx1 = fx0 - 1.0f;
-    ix1 = (( ix0 + 1 ) % px) & 0xff; // Wrap to 0..px-1 *and* wrap to 0..255
-    ix0 = ( ix0 % px ) & 0xff;      // (because px might be greater than 256)
+    ix1 = pwrap( ix0 + 1, px ) & 0xff; // Wrap to 0..px-1 *and* wrap to 0..255
+    ix0 = pwrap( ix0, px ) & 0xff;     // (because px might be greater than 256)
 
     s = FADE( fx0 );
 
@@ -211,39 +259,45 @@ float noise2( float x, float y )
 }
 
 //---------------------------------------------------------------------
-/** 2D float Perlin periodic noise.
- */
-float pnoise2( float x, float y, int px, int py )
+// 2D periodic noise within the cell with the wrapped corners ix0..ix1,
+// iy0..iy1, at the offset (fx0,fy0) from its first corner. This is shared
+// by pnoise2() and pnoisetable_eval2(), and it uses gdot2() instead of
+// grad2() for speed.
+static float pnoise2_cell( int ix0, int iy0, int ix1, int iy1,
+                           float fx0, float fy0 )
 {
-    int ix0, iy0, ix1, iy1;
-    float fx0, fy0, fx1, fy1;
+    float fx1 = fx0 - 1.0f;
+    float fy1 = fy0 - 1.0f;
     float s, t, nx0, nx1, n0, n1;
 
-    ix0 = FASTFLOOR( x ); // Integer part of x
-    iy0 = FASTFLOOR( y ); // Integer part of y
-    fx0 = x - ix0;        // Fractional part of x
-    fy0 = y - iy0;        // Fractional part of y
-    fx1 = fx0 - 1.0f;
-    fy1 = fy0 - 1.0f;
-    ix1 = (( ix0 + 1 ) % px) & 0xff;  // Wrap to 0..px-1 and wrap to 0..255
-    iy1 = (( iy0 + 1 ) % py) & 0xff;  // Wrap to 0..py-1 and wrap to 0..255
-    ix0 = ( ix0 % px ) & 0xff;
-    iy0 = ( iy0 % py ) & 0xff;
-    
     t = FADE( fy0 );
     s = FADE( fx0 );
 
-    nx0 = grad2(perm[ix0 + perm[iy0]], fx0, fy0);
-    nx1 = grad2(perm[ix0 + perm[iy1]], fx0, fy1);
+    nx0 = gdot2(perm[ix0 + perm[iy0]], fx0, fy0);
+    nx1 = gdot2(perm[ix0 + perm[iy1]], fx0, fy1);
     n0 = LERP( t, nx0, nx1 );
 
-    nx0 = grad2(perm[ix1 + perm[iy0]], fx1, fy0);
-    nx1 = grad2(perm[ix1 + perm[iy1]], fx1, fy1);
+    nx0 = gdot2(perm[ix1 + perm[iy0]], fx1, fy0);
+    nx1 = gdot2(perm[ix1 + perm[iy1]], fx1, fy1);
     n1 = LERP(t, nx0, nx1);
 
     return 0.507f * ( LERP( s, n0, n1 ) );
 }
 
+/** 2D float Perlin periodic noise.
+ */
+float pnoise2( float x, float y, int px, int py )
+{
+    int ix0 = FASTFLOOR( x ); // Integer part of x
+    int iy0 = FASTFLOOR( y ); // Integer part of y
+
+    // Wrap to 0..px-1 and wrap to 0..255
+    return pnoise2_cell( pwrap( ix0, px ) & 0xff, pwrap( iy0, py ) & 0xff,
+                         pwrap( ix0 + 1, px ) & 0xff,
+                         pwrap( iy0 + 1, py ) & 0xff,
+                         x - ix0, y - iy0 );
+}
+
 
 //---------------------------------------------------------------------
 /** 3D float Perlin noise.
@@ -299,51 +353,37 @@ float noise3( float x, float y, float z )
 }
 
 //---------------------------------------------------------------------
-/** 3D float Perlin periodic noise.
- */
-float pnoise3( float x, float y, float z, int px, int py, int pz )
+// 3D periodic noise within one cell, like pnoise2_cell().
+static float pnoise3_cell( int ix0, int iy0, int iz0,
+                           int ix1, int iy1, int iz1,
+                           float fx0, float fy0, float fz0 )
 {
-    int ix0, iy0, ix1, iy1, iz0, iz1;
-    float fx0, fy0, fz0, fx1, fy1, fz1;
+    float fx1 = fx0 - 1.0f;
+    float fy1 = fy0 - 1.0f;
+    float fz1 = fz0 - 1.0f;
     float s, t, r;
     float nxy0, nxy1, nx0, nx1, n0, n1;
 
-    ix0 = FASTFLOOR( x ); // Integer part of x
-    iy0 = FASTFLOOR( y ); // Integer part of y
-    iz0 = FASTFLOOR( z ); // Integer part of z
-    fx0 = x - ix0;        // Fractional part of x
-    fy0 = y - iy0;        // Fractional part of y
-    fz0 = z - iz0;        // Fractional part of z
-    fx1 = fx0 - 1.0f;
-    fy1 = fy0 - 1.0f;
-    fz1 = fz0 - 1.0f;
-    ix1 = (( ix0 + 1 ) % px ) & 0xff; // Wrap to 0..px-1 and wrap to 0..255
-    iy1 = (( iy0 + 1 ) % py ) & 0xff; // Wrap to 0..py-1 and wrap to 0..255
-    iz1 = (( iz0 + 1 ) % pz ) & 0xff; // Wrap to 0..pz-1 and wrap to 0..255
-    ix0 = ( ix0 % px ) & 0xff;
-    iy0 = ( iy0 % py ) & 0xff;
-    iz0 = ( iz0 % pz ) & 0xff;
-    
     r = FADE( fz0 );
     t = FADE( fy0 );
     s = FADE( fx0 );
 
-    nxy0 = grad3(perm[ix0 + perm[iy0 + perm[iz0]]], fx0, fy0, fz0);
-    nxy1 = grad3(perm[ix0 + perm[iy0 + perm[iz1]]], fx0, fy0, fz1);
+    nxy0 = gdot3(perm[ix0 + perm[iy0 + perm[iz0]]], fx0, fy0, fz0);
+    nxy1 = gdot3(perm[ix0 + perm[iy0 + perm[iz1]]], fx0, fy0, fz1);
     nx0 = LERP( r, nxy0, nxy1 );
 
-    nxy0 = grad3(perm[ix0 + perm[iy1 + perm[iz0]]], fx0, fy1, fz0);
-    nxy1 = grad3(perm[ix0 + perm[iy1 + perm[iz1]]], fx0, fy1, fz1);
+    nxy0 = gdot3(perm[ix0 + perm[iy1 + perm[iz0]]], fx0, fy1, fz0);
+    nxy1 = gdot3(perm[ix0 + perm[iy1 + perm[iz1]]], fx0, fy1, fz1);
     nx1 = LERP( r, nxy0, nxy1 );
 
     n0 = LERP( t, nx0, nx1 );
 
-    nxy0 = grad3(perm[ix1 + perm[iy0 + perm[iz0]]], fx1, fy0, fz0);
-    nxy1 = grad3(perm[ix1 + perm[iy0 + perm[iz1]]], fx1, fy0, fz1);
+    nxy0 = gdot3(perm[ix1 + perm[iy0 + perm[iz0]]], fx1, fy0, fz0);
+    nxy1 = gdot3(perm[ix1 + perm[iy0 + perm[iz1]]], fx1, fy0, fz1);
     nx0 = LERP( r, nxy0, nxy1 );
 
-    nxy0 = grad3(perm[ix1 + perm[iy1 + perm[iz0]]], fx1, fy1, fz0);
-    nxy1 = grad3(perm[ix1 + perm[iy1 + perm[iz1]]], fx1, fy1, fz1);
+    nxy0 = gdot3(perm[ix1 + perm[iy1 + perm[iz0]]], fx1, fy1, fz0);
+    nxy1 = gdot3(perm[ix1 + perm[iy1 + perm[iz1]]], fx1, fy1, fz1);
     nx1 = LERP( r, nxy0, nxy1 );
 
     n1 = LERP( t, nx0, nx1 );
@@ -351,6 +391,23 @@ float pnoise3( float x, float y, float z, int px, int py, int pz )
     return 0.936f * ( LERP( s, n0, n1 ) );
 }
 
+/** 3D float Perlin periodic noise.
+ */
+float pnoise3( float x, float y, float z, int px, int py, int pz )
+{
+    int ix0 = FASTFLOOR( x ); // Integer part of x
+    int iy0 = FASTFLOOR( y ); // Integer part of y
+    int iz0 = FASTFLOOR( z ); // Integer part of z
+
+    // Wrap to 0..px-1 etc. and wrap to 0..255
+    return pnoise3_cell( pwrap( ix0, px ) & 0xff, pwrap( iy0, py ) & 0xff,
+                         pwrap( iz0, pz ) & 0xff,
+                         pwrap( ix0 + 1, px ) & 0xff,
+                         pwrap( iy0 + 1, py ) & 0xff,
+                         pwrap( iz0 + 1, pz ) & 0xff,
+                         x - ix0, y - iy0, z - iz0 );
+}
+
 
 //---------------------------------------------------------------------
 /** 4D float Perlin noise.
@@ -437,81 +494,61 @@ float noise4( float x, float y, float z, float w )
 }
 
 //---------------------------------------------------------------------
-/** 4D float Perlin periodic noise.
- */
-
-float pnoise4( float x, float y, float z, float w,
-                            int px, int py, int pz, int pw )
+// 4D periodic noise within one cell, like pnoise2_cell().
+static float pnoise4_cell( int ix0, int iy0, int iz0, int iw0,
+                           int ix1, int iy1, int iz1, int iw1,
+                           float fx0, float fy0, float fz0, float fw0 )
 {
-    int ix0, iy0, iz0, iw0, ix1, iy1, iz1, iw1;
-    float fx0, fy0, fz0, fw0, fx1, fy1, fz1, fw1;
+    float fx1 = fx0 - 1.0f;
+    float fy1 = fy0 - 1.0f;
+    float fz1 = fz0 - 1.0f;
+    float fw1 = fw0 - 1.0f;
     float s, t, r, q;
     float nxyz0, nxyz1, nxy0, nxy1, nx0, nx1, n0, n1;
 
-    ix0 = FASTFLOOR( x ); // Integer part of x
-    iy0 = FASTFLOOR( y ); // Integer part of y
-    iz0 = FASTFLOOR( z ); // Integer part of y
-    iw0 = FASTFLOOR( w ); // Integer part of w
-    fx0 = x - ix0;        // Fractional part of x
-    fy0 = y - iy0;        // Fractional part of y
-    fz0 = z - iz0;        // Fractional part of z
-    fw0 = w - iw0;        // Fractional part of w
-    fx1 = fx0 - 1.0f;
-    fy1 = fy0 - 1.0f;
-    fz1 = fz0 - 1.0f;
-    fw1 = fw0 - 1.0f;
-    ix1 = (( ix0 + 1 ) % px ) & 0xff;  // Wrap to 0..px-1 and wrap to 0..255
-    iy1 = (( iy0 + 1 ) % py ) & 0xff;  // Wrap to 0..py-1 and wrap to 0..255
-    iz1 = (( iz0 + 1 ) % pz ) & 0xff;  // Wrap to 0..pz-1 and wrap to 0..255
-    iw1 = (( iw0 + 1 ) % pw ) & 0xff;  // Wrap to 0..pw-1 and wrap to 0..255
-    ix0 = ( ix0 % px ) & 0xff;
-    iy0 = ( iy0 % py ) & 0xff;
-    iz0 = ( iz0 % pz ) & 0xff;
-    iw0 = ( iw0 % pw ) & 0xff;
-
     q = FADE( fw0 );
     r = FADE( fz0 );
     t = FADE( fy0 );
     s = FADE( fx0 );
 
-    nxyz0 = grad4(perm[ix0 + perm[iy0 + perm[iz0 + perm[iw0]]]], fx0, fy0, fz0, fw0);
-    nxyz1 = grad4(perm[ix0 + perm[iy0 + perm[iz0 + perm[iw1]]]], fx0, fy0, fz0, fw1);
+    nxyz0 = gdot4(perm[ix0 + perm[iy0 + perm[iz0 + perm[iw0]]]], fx0, fy0, fz0, fw0);
+    nxyz1 = gdot4(perm[ix0 + perm[iy0 + perm[iz0 + perm[iw1]]]], fx0, fy0, fz0, fw1);
     nxy0 = LERP( q, nxyz0, nxyz1 );
         
-    nxyz0 = grad4(perm[ix0 + perm[iy0 + perm[iz1 + perm[iw0]]]], fx0, fy0, fz1, fw0);
-    nxyz1 = grad4(perm[ix0 + perm[iy0 + perm[iz1 + perm[iw1]]]], fx0, fy0, fz1, fw1);
+    nxyz0 = gdot4(perm[ix0 + perm[iy0 + perm[iz1 + perm[iw0]]]], fx0, fy0, fz1, fw0);
+    nxyz1 = gdot4(perm[ix0 + perm[iy0 + perm[iz1 + perm[iw1]]]], fx0, fy0, fz1, fw1);
     nxy1 = LERP( q, nxyz0, nxyz1 );
         
     nx0 = LERP ( r, nxy0, nxy1 );
 
-    nxyz0 = grad4(perm[ix0 + perm[iy1 + perm[iz0 + perm[iw0]]]], fx0, fy1, fz0, fw0);
-    nxyz1 = grad4(perm[ix0 + perm[iy1 + perm[iz0 + perm[iw1]]]], fx0, fy1, fz0, fw1);
+    nxyz0 = gdot4(perm[ix0 + perm[iy1 + perm[iz0 + perm[iw0]]]], fx0, fy1, fz0, fw0);
+    nxyz1 = gdot4(perm[ix0 + perm[iy1 + perm[iz0 + perm[iw1]]]], fx0, fy1, fz0, fw1);
     nxy0 = LERP( q, nxyz0, nxyz1 );
         
-    nxyz0 = grad4(perm[ix0 + perm[iy1 + perm[iz1 + perm[iw0]]]], fx0, fy1, fz1, fw0);
-    nxyz1 = grad4(perm[ix0 + perm[iy1 + perm[iz1 + perm[iw1]]]], fx0, fy1, fz1, fw1);
+    nxyz0 = gdot4(perm[ix0 + perm[iy1 + perm[iz1 + perm[iw0]]]], fx0, fy1, fz1, fw0);
+    nxyz1 = gdot4(perm[ix0 + perm[iy1 + perm[iz1 + perm[iw1]]]], fx0, fy1, fz1, fw1);
     nxy1 = LERP( q, nxyz0, nxyz1 );
 
     nx1 = LERP ( r, nxy0, nxy1 );
 
     n0 = LERP( t, nx0, nx1 );
 
-    nxyz0 = grad4(perm[ix1 + perm[iy0 + perm[iz0 + perm[iw0]]]], fx1, fy0, fz0, fw0);
-    nxyz1 = grad4(perm[ix1 + perm[iy0 + perm[iz0 + perm[iw1]]]], fx1, fy0, fz0, fw1);
+    nxyz0 = gdot4(perm[ix1 + perm[iy0 + perm[iz0 + perm[iw0]]]], fx1, fy0, fz0, fw0);
+    nxyz1 = gdot4(perm[ix1 + perm[iy0 + perm[iz0 + perm[iw1]]]], fx1, fy0, fz0, fw1);
     nxy0 = LERP( q, nxyz0, nxyz1 );
         
-    nxyz0 = grad4(perm[ix1 + perm[iy0 + perm[iz1 + perm[iw0]]]], fx1, fy0, fz1, fw0);
-    nxyz1 = grad4(perm[ix1 + perm[iy0 + perm[iz1 + perm[iw1]]]], fx1, fy0, fz1, fw1);
+    nxyz0 = gdot4(perm[ix1 + perm[iy0 + perm[iz1 + perm[iw0]]]], fx1, fy0, fz1, fw0);
+    nxyz1 = gdot4(perm[ix1 + perm[iy0 + perm[iz1 + perm[iw1]]]], fx1, fy0, fz1, fw1);
     nxy1 = LERP( q, nxyz0, nxyz1 );
 
     nx0 = LERP ( r, nxy0, nxy1 );
 
-    nxyz0 = grad4(perm[ix1 + perm[iy1 + perm[iz0 + perm[iw0]]]], fx1, fy1, fz0, fw0);
-    nxyz1 = grad4(perm[ix1 + perm[iy1 + perm[iz0 + perm[iw1]]]], fx1, fy1, fz0, fw1);
+    nxyz0 = gdot4(perm[ix1 + perm[iy1 + perm[iz0 + perm[iw0]]]], fx1, fy1, fz0, fw0);
+    nxyz1 = gdot4(perm[ix1 + perm[iy1 + perm[iz0 + perm[iw1]]]], fx1, fy1, fz0, fw1);
     nxy0 = LERP( q, nxyz0, nxyz1 );
         
-    nxyz0 = grad4(perm[ix1 + perm[iy1 + perm[iz1 + perm[iw0]]]], fx1, fy1, fz1, fw0);
-    nxyz1 = grad4(perm[ix1 + perm[iy1 + perm[iz1 + perm[iw1]]]], fx1, fy1, fz1, fw1);
+    nxyz0 = gdot4(perm[ix1 + perm[iy1 + perm[iz1 + perm[iw0]]]], fx1, fy1, fz1, fw0);
+    nxyz1 = gdot4(perm[ix1 + perm[iy1 + perm[iz1 + perm[iw1]]]], fx1, fy1, fz1, fw1);
     nxy1 = LERP( q, nxyz0, nxyz1 );
 
     nx1 = LERP ( r, nxy0, nxy1 );
@@ -521,4 +558,1168 @@ float pnoise4( float x, float y, float z, float w,
     return 0.87f * ( LERP( s, n0, n1 ) );
 }
 
+/** 4D float Perlin periodic noise.
+ */
+
+float pnoise4( float x, float y, float z, float w,
+                            int px, int py, int pz, int pw )
+{
+    int ix0 = FASTFLOOR( x ); // Integer part of x
+    int iy0 = FASTFLOOR( y ); // Integer part of y
+    int iz0 = FASTFLOOR( z ); // Integer part of z
+    int iw0 = FASTFLOOR( w ); // Integer part of w
+
+    // Wrap to 0..px-1 etc. and wrap to 0..255
+    return pnoise4_cell( pwrap( ix0, px ) & 0xff, pwrap( iy0, py ) & 0xff,
+                         pwrap( iz0, pz ) & 0xff, pwrap( iw0, pw ) & 0xff,
+                         pwrap( ix0 + 1, px ) & 0xff,
+                         pwrap( iy0 + 1, py ) & 0xff,
+                         pwrap( iz0 + 1, pz ) & 0xff,
+                         pwrap( iw0 + 1, pw ) & 0xff,
+                         x - ix0, y - iy0, z - iz0, w - iw0 );
+}
+
+//---------------------------------------------------------------------
+/*
+ * Conservative value bounds for 3D noise over an axis-aligned box.
+ * Within one lattice cell, noise3() is a weighted average of the eight
+ * corner gradient ramps grad3(hash, x, y, z), with non-negative fade
+ * weights that sum to one. Each ramp is a sum of two signed coordinates,
+ * so its range over the part of the box inside the cell is found directly
+ * from the box limits, and each weight is a product of fade values with
+ * a known range. The largest possible average is then found by starting
+ * from the smallest weights and giving the remaining weight to the
+ * largest ramp values first, and the smallest average likewise.
+ * Boxes that cover more than BOUNDS_MAXCELLS cells get the global bound:
+ * a ramp never exceeds 2 in magnitude, so 0.936*2 bounds all noise values.
+ */
+
+#define BOUNDS_MAXCELLS 512
+#define BOUNDS_EPS 1.0e-5f // Margin for rounding errors in noise3()
+#define NOISE3_BOUND 1.872f
+
+static void grad3_range( int hash, const float *lo, const float *hi,
+                         float *gmin, float *gmax ) {
+    int h = hash & 15;
+    int a = h<8 ? 0 : 1;                    // Axis of u in grad3()
+    int b = h<4 ? 1 : h==12||h==14 ? 0 : 2; // Axis of v in grad3()
+    if(h&1) { *gmin = -hi[a]; *gmax = -lo[a]; }
+    else    { *gmin =  lo[a]; *gmax =  hi[a]; }
+    if(h&2) { *gmin -= hi[b]; *gmax -= lo[b]; }
+    else    { *gmin += lo[b]; *gmax += hi[b]; }
+}
+
+// Largest value of the sum of w[c]*r[c] for weights w[c] between wlo[c]
+// and whi[c] that sum to one.
+static float blend_max( const float *wlo, const float *whi, const float *r ) {
+    int order[8], c, m;
+    float rest = 1.0f, sum = 0.0f;
+    for( c = 0; c < 8; c++ ) { // Sort the corners by decreasing r
+        sum += wlo[c] * r[c];
+        rest -= wlo[c];
+        for( m = c; m > 0 && r[order[m-1]] < r[c]; m-- ) order[m] = order[m-1];
+        order[m] = c;
+    }
+    for( m = 0; m < 8 && rest > 0.0f; m++ ) {
+        float w = whi[order[m]] - wlo[order[m]];
+        if( w > rest ) w = rest;
+        sum += w * r[order[m]];
+        rest -= w;
+    }
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** Guaranteed bounds for noise3() over the box [x0,x1]x[y0,y1]x[z0,z1].
+ */
+void noise3_bounds( float x0, float y0, float z0,
+                    float x1, float y1, float z1, float *nmin, float *nmax )
+{
+    int ix0, iy0, iz0, ix1, iy1, iz1, i, j, k, c;
+    float lo[3], hi[3], dlo[3], dhi[3], slo[3], shi[3];
+    float wlo[8], whi[8], rlo[8], rhi[8];
+    float bmin, bmax, v;
+
+    // Accept the corners in either order
+    if( x0 > x1 ) { v = x0; x0 = x1; x1 = v; }
+    if( y0 > y1 ) { v = y0; y0 = y1; y1 = v; }
+    if( z0 > z1 ) { v = z0; z0 = z1; z1 = v; }
+
+    ix0 = FASTFLOOR( x0 ); // Range of cells touched by the box
+    iy0 = FASTFLOOR( y0 );
+    iz0 = FASTFLOOR( z0 );
+    ix1 = FASTFLOOR( x1 );
+    iy1 = FASTFLOOR( y1 );
+    iz1 = FASTFLOOR( z1 );
+
+    if( (double)( ix1 - ix0 + 1 ) * ( iy1 - iy0 + 1 ) * ( iz1 - iz0 + 1 )
+        > BOUNDS_MAXCELLS ) {
+        *nmin = -NOISE3_BOUND;
+        *nmax = NOISE3_BOUND;
+        return;
+    }
+
+    bmin = NOISE3_BOUND;
+    bmax = -NOISE3_BOUND;
+    for( k = iz0; k <= iz1; k++ )
+    for( j = iy0; j <= iy1; j++ )
+    for( i = ix0; i <= ix1; i++ ) {
+        // The part of the box inside this cell, relative to the cell origin
+        lo[0] = ( x0 > i ) ? x0 - i : 0.0f;
+        lo[1] = ( y0 > j ) ? y0 - j : 0.0f;
+        lo[2] = ( z0 > k ) ? z0 - k : 0.0f;
+        hi[0] = ( x1 < i + 1 ) ? x1 - i : 1.0f;
+        hi[1] = ( y1 < j + 1 ) ? y1 - j : 1.0f;
+        hi[2] = ( z1 < k + 1 ) ? z1 - k : 1.0f;
+        for( c = 0; c < 3; c++ ) {
+            slo[c] = FADE( lo[c] );
+            shi[c] = FADE( hi[c] );
+        }
+
+        for( c = 0; c < 8; c++ ) {
+            int dx = ( c >> 2 ) & 1, dy = ( c >> 1 ) & 1, dz = c & 1;
+            int hash = perm[ ( ( i + dx ) & 0xff )
+                           + perm[ ( ( j + dy ) & 0xff )
+                                 + perm[ ( k + dz ) & 0xff ] ] ];
+            dlo[0] = lo[0] - dx; dhi[0] = hi[0] - dx;
+            dlo[1] = lo[1] - dy; dhi[1] = hi[1] - dy;
+            dlo[2] = lo[2] - dz; dhi[2] = hi[2] - dz;
+            grad3_range( hash, dlo, dhi, &rlo[c], &rhi[c] );
+            rlo[c] = -rlo[c]; // blend_max() of -r gives the negated minimum
+
+            // Weight of this corner: s for the far corner, 1-s for the near
+            wlo[c] = ( dx ? slo[0] : 1.0f - shi[0] )
+                   * ( dy ? slo[1] : 1.0f - shi[1] )
+                   * ( dz ? slo[2] : 1.0f - shi[2] );
+            whi[c] = ( dx ? shi[0] : 1.0f - slo[0] )
+                   * ( dy ? shi[1] : 1.0f - slo[1] )
+                   * ( dz ? shi[2] : 1.0f - slo[2] );
+        }
+        v = -blend_max( wlo, whi, rlo );
+        if( v < bmin ) bmin = v;
+        v = blend_max( wlo, whi, rhi );
+        if( v > bmax ) bmax = v;
+    }
+
+    *nmin = 0.936f * bmin - BOUNDS_EPS;
+    *nmax = 0.936f * bmax + BOUNDS_EPS;
+}
+
+//---------------------------------------------------------------------
+/** 2D and 3D float Perlin noise over arrays of points.
+ * These are plain loops over the scalar functions above, but being in
+ * the same compilation unit lets the compiler inline the noise code, and
+ * they give the grid generator in "noisegen.c" one call per row of points.
+ */
+void noise2_batch( int n, const float *x, const float *y, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = noise2( x[i], y[i] );
+}
+
+void noise3_batch( int n, const float *x, const float *y, const float *z,
+                   float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = noise3( x[i], y[i], z[i] );
+}
+
+//---------------------------------------------------------------------
+/** Incremental evaluation of noise3() along a ray.
+ * The hashed gradient indices of the 8 corners of the current cell are
+ * kept in the ray, and they are only looked up again when a sample falls
+ * in a different cell. The rest is the same arithmetic as in noise3(),
+ * so the results are identical.
+ */
+void noise3ray_init( noise3ray *ray, float ox, float oy, float oz,
+                     float dx, float dy, float dz )
+{
+    ray->ox = ox; ray->oy = oy; ray->oz = oz;
+    ray->dx = dx; ray->dy = dy; ray->dz = dz;
+    ray->valid = 0;
+}
+
+float noise3ray_eval( noise3ray *ray, float t )
+{
+    float x = ray->ox + t*ray->dx;
+    float y = ray->oy + t*ray->dy;
+    float z = ray->oz + t*ray->dz;
+    const unsigned char *h = ray->hash;
+    int ix0, iy0, iz0, ix1, iy1, iz1;
+    float fx0, fy0, fz0, fx1, fy1, fz1;
+    float s, u, r;
+    float nxy0, nxy1, nx0, nx1, n0, n1;
+
+    ix0 = FASTFLOOR( x );
+    iy0 = FASTFLOOR( y );
+    iz0 = FASTFLOOR( z );
+    fx0 = x - ix0;
+    fy0 = y - iy0;
+    fz0 = z - iz0;
+    fx1 = fx0 - 1.0f;
+    fy1 = fy0 - 1.0f;
+    fz1 = fz0 - 1.0f;
+
+    // Crossed into a new cell: look up its corner hashes
+    if( !ray->valid || ix0 != ray->ix || iy0 != ray->iy || iz0 != ray->iz ) {
+        ray->ix = ix0;
+        ray->iy = iy0;
+        ray->iz = iz0;
+        ray->valid = 1;
+        ix1 = ( ix0 + 1 ) & 0xff;
+        iy1 = ( iy0 + 1 ) & 0xff;
+        iz1 = ( iz0 + 1 ) & 0xff;
+        ix0 = ix0 & 0xff;
+        iy0 = iy0 & 0xff;
+        iz0 = iz0 & 0xff;
+        ray->hash[0] = perm[ix0 + perm[iy0 + perm[iz0]]];
+        ray->hash[1] = perm[ix0 + perm[iy0 + perm[iz1]]];
+        ray->hash[2] = perm[ix0 + perm[iy1 + perm[iz0]]];
+        ray->hash[3] = perm[ix0 + perm[iy1 + perm[iz1]]];
+        ray->hash[4] = perm[ix1 + perm[iy0 + perm[iz0]]];
+        ray->hash[5] = perm[ix1 + perm[iy0 + perm[iz1]]];
+        ray->hash[6] = perm[ix1 + perm[iy1 + perm[iz0]]];
+        ray->hash[7] = perm[ix1 + perm[iy1 + perm[iz1]]];
+    }
+
+    r = FADE( fz0 );
+    u = FADE( fy0 );
+    s = FADE( fx0 );
+
+    nxy0 = grad3(h[0], fx0, fy0, fz0);
+    nxy1 = grad3(h[1], fx0, fy0, fz1);
+    nx0 = LERP( r, nxy0, nxy1 );
+
+    nxy0 = grad3(h[2], fx0, fy1, fz0);
+    nxy1 = grad3(h[3], fx0, fy1, fz1);
+    nx1 = LERP( r, nxy0, nxy1 );
+
+    n0 = LERP( u, nx0, nx1 );
+
+    nxy0 = grad3(h[4], fx1, fy0, fz0);
+    nxy1 = grad3(h[5], fx1, fy0, fz1);
+    nx0 = LERP( r, nxy0, nxy1 );
+
+    nxy0 = grad3(h[6], fx1, fy1, fz0);
+    nxy1 = grad3(h[7], fx1, fy1, fz1);
+    nx1 = LERP( r, nxy0, nxy1 );
+
+    n1 = LERP( u, nx0, nx1 );
+
+    return 0.936f * ( LERP( s, n0, n1 ) );
+}
+
+void noise3ray_march( noise3ray *ray, float t0, float dt, int n,
+                      float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = noise3ray_eval( ray, t0 + i*dt );
+}
+
+//---------------------------------------------------------------------
+/*
+ * Many points in one lattice cell. The eight corner gradients of the cell
+ * are looked up once and kept as floats, and each point then costs only
+ * the fades, eight dot products and seven blends, with no table lookups
+ * and no branches. The dot products are the same as those of gdot3(),
+ * so the values are identical to noise3().
+ */
+
+// Gradients of the corners of the cell (ix0,iy0,iz0), corner (i,j,k) at
+// g[a][4*i+2*j+k] for axis a
+static void cell3_grads( int ix0, int iy0, int iz0, float g[3][8] )
+{
+    int ix1 = ( ix0 + 1 ) & 0xff;
+    int iy1 = ( iy0 + 1 ) & 0xff;
+    int iz1 = ( iz0 + 1 ) & 0xff;
+    int hash[8], c;
+
+    ix0 = ix0 & 0xff;
+    iy0 = iy0 & 0xff;
+    iz0 = iz0 & 0xff;
+    hash[0] = perm[ix0 + perm[iy0 + perm[iz0]]];
+    hash[1] = perm[ix0 + perm[iy0 + perm[iz1]]];
+    hash[2] = perm[ix0 + perm[iy1 + perm[iz0]]];
+    hash[3] = perm[ix0 + perm[iy1 + perm[iz1]]];
+    hash[4] = perm[ix1 + perm[iy0 + perm[iz0]]];
+    hash[5] = perm[ix1 + perm[iy0 + perm[iz1]]];
+    hash[6] = perm[ix1 + perm[iy1 + perm[iz0]]];
+    hash[7] = perm[ix1 + perm[iy1 + perm[iz1]]];
+    for( c = 0; c < 8; c++ ) {
+        const signed char *v = grad3vec[hash[c] & 15];
+        g[0][c] = v[0];
+        g[1][c] = v[1];
+        g[2][c] = v[2];
+    }
+}
+
+// Noise at n points with the gradients g of their cell, which has its
+// origin at (ox,oy,oz)
+static void cell3_eval( float g[3][8], float ox, float oy, float oz,
+                        int n, const float *x, const float *y,
+                        const float *z, float *result )
+{
+    const float *gx = g[0], *gy = g[1], *gz = g[2];
+    int i;
+
+    for( i = 0; i < n; i++ ) {
+        float fx0 = x[i] - ox;
+        float fy0 = y[i] - oy;
+        float fz0 = z[i] - oz;
+        float fx1 = fx0 - 1.0f;
+        float fy1 = fy0 - 1.0f;
+        float fz1 = fz0 - 1.0f;
+        float r = FADE( fz0 );
+        float t = FADE( fy0 );
+        float s = FADE( fx0 );
+        float nx0, nx1, n0, n1;
+
+        nx0 = LERP( r, gx[0]*fx0 + gy[0]*fy0 + gz[0]*fz0,
+                       gx[1]*fx0 + gy[1]*fy0 + gz[1]*fz1 );
+        nx1 = LERP( r, gx[2]*fx0 + gy[2]*fy1 + gz[2]*fz0,
+                       gx[3]*fx0 + gy[3]*fy1 + gz[3]*fz1 );
+        n0 = LERP( t, nx0, nx1 );
+        nx0 = LERP( r, gx[4]*fx1 + gy[4]*fy0 + gz[4]*fz0,
+                       gx[5]*fx1 + gy[5]*fy0 + gz[5]*fz1 );
+        nx1 = LERP( r, gx[6]*fx1 + gy[6]*fy1 + gz[6]*fz0,
+                       gx[7]*fx1 + gy[7]*fy1 + gz[7]*fz1 );
+        n1 = LERP( t, nx0, nx1 );
+        result[i] = 0.936f * ( LERP( s, n0, n1 ) );
+    }
+}
+
+void noise3_cell_batch( int ix, int iy, int iz, int n, const float *fx,
+                        const float *fy, const float *fz, float *result )
+{
+    float g[3][8];
+    cell3_grads( ix, iy, iz, g );
+    cell3_eval( g, 0.0f, 0.0f, 0.0f, n, fx, fy, fz, result );
+}
+
+void noise3_grouped_batch( int n, const float *x, const float *y,
+                           const float *z, float *result )
+{
+    float g[3][8];
+    int i = 0, j, ix, iy, iz;
+
+    while( i < n ) {
+        float xi = x[i], yi = y[i], zi = z[i];
+        ix = FASTFLOOR( xi );
+        iy = FASTFLOOR( yi );
+        iz = FASTFLOOR( zi );
+        // Find the run of points in the same cell
+        for( j = i + 1; j < n; j++ ) {
+            float xj = x[j], yj = y[j], zj = z[j];
+            if( FASTFLOOR( xj ) != ix || FASTFLOOR( yj ) != iy
+                || FASTFLOOR( zj ) != iz ) break;
+        }
+        cell3_grads( ix, iy, iz, g );
+        cell3_eval( g, (float)ix, (float)iy, (float)iz, j - i,
+                    x + i, y + i, z + i, result + i );
+        i = j;
+    }
+}
+
+//---------------------------------------------------------------------
+/** 2D and 3D float Perlin noise along a scanline.
+ * Everything that depends only on y and z, namely the fade weights, the
+ * fractional parts and the partial hashes perm[iy + perm[iz]], is computed
+ * once for the whole span. The full corner hashes are looked up again only
+ * when the x coordinate crosses into a new cell. The arithmetic for each
+ * point is the same as in noise2() and noise3(), so the results are
+ * identical to calling those for every point.
+ */
+void noise2_span( float x, float y, float dx, int n, float *result )
+{
+    int i, ix0, ix1, iy0, iy1, cx, hy0, hy1, h00, h01, h10, h11;
+    float xi, fx0, fy0, fx1, fy1;
+    float s, t, nx0, nx1, n0, n1;
+
+    iy0 = FASTFLOOR( y );
+    fy0 = y - iy0;
+    fy1 = fy0 - 1.0f;
+    iy1 = (iy0 + 1) & 0xff;
+    iy0 = iy0 & 0xff;
+    t = FADE( fy0 );
+    hy0 = perm[iy0];
+    hy1 = perm[iy1];
+
+    cx = h00 = h01 = h10 = h11 = 0;
+    for( i = 0; i < n; i++ ) {
+        xi = x + i*dx;
+        ix0 = FASTFLOOR( xi );
+        fx0 = xi - ix0;
+        fx1 = fx0 - 1.0f;
+        if( i == 0 || ix0 != cx ) { // Crossed into a new cell
+            cx = ix0;
+            ix1 = (ix0 + 1) & 0xff;
+            ix0 = ix0 & 0xff;
+            h00 = perm[ix0 + hy0];
+            h01 = perm[ix0 + hy1];
+            h10 = perm[ix1 + hy0];
+            h11 = perm[ix1 + hy1];
+        }
+        s = FADE( fx0 );
+
+        nx0 = grad2(h00, fx0, fy0);
+        nx1 = grad2(h01, fx0, fy1);
+        n0 = LERP( t, nx0, nx1 );
+
+        nx0 = grad2(h10, fx1, fy0);
+        nx1 = grad2(h11, fx1, fy1);
+        n1 = LERP(t, nx0, nx1);
+
+        result[i] = 0.507f * ( LERP( s, n0, n1 ) );
+    }
+}
+
+void noise3_span( float x, float y, float z, float dx, int n, float *result )
+{
+    int i, ix0, ix1, iy0, iy1, iz0, iz1, cx;
+    int hyz[4], h[8] = { 0 };
+    float xi, fx0, fy0, fz0, fx1, fy1, fz1;
+    float s, t, r;
+    float nxy0, nxy1, nx0, nx1, n0, n1;
+
+    iy0 = FASTFLOOR( y );
+    iz0 = FASTFLOOR( z );
+    fy0 = y - iy0;
+    fz0 = z - iz0;
+    fy1 = fy0 - 1.0f;
+    fz1 = fz0 - 1.0f;
+    iy1 = ( iy0 + 1 ) & 0xff;
+    iz1 = ( iz0 + 1 ) & 0xff;
+    iy0 = iy0 & 0xff;
+    iz0 = iz0 & 0xff;
+    r = FADE( fz0 );
+    t = FADE( fy0 );
+    hyz[0] = perm[iy0 + perm[iz0]];
+    hyz[1] = perm[iy0 + perm[iz1]];
+    hyz[2] = perm[iy1 + perm[iz0]];
+    hyz[3] = perm[iy1 + perm[iz1]];
+
+    cx = 0;
+    for( i = 0; i < n; i++ ) {
+        xi = x + i*dx;
+        ix0 = FASTFLOOR( xi );
+        fx0 = xi - ix0;
+        fx1 = fx0 - 1.0f;
+        if( i == 0 || ix0 != cx ) { // Crossed into a new cell
+            cx = ix0;
+            ix1 = ( ix0 + 1 ) & 0xff;
+            ix0 = ix0 & 0xff;
+            h[0] = perm[ix0 + hyz[0]];
+            h[1] = perm[ix0 + hyz[1]];
+            h[2] = perm[ix0 + hyz[2]];
+            h[3] = perm[ix0 + hyz[3]];
+            h[4] = perm[ix1 + hyz[0]];
+            h[5] = perm[ix1 + hyz[1]];
+            h[6] = perm[ix1 + hyz[2]];
+            h[7] = perm[ix1 + hyz[3]];
+        }
+        s = FADE( fx0 );
+
+        nxy0 = grad3(h[0], fx0, fy0, fz0);
+        nxy1 = grad3(h[1], fx0, fy0, fz1);
+        nx0 = LERP( r, nxy0, nxy1 );
+
+        nxy0 = grad3(h[2], fx0, fy1, fz0);
+        nxy1 = grad3(h[3], fx0, fy1, fz1);
+        nx1 = LERP( r, nxy0, nxy1 );
+
+        n0 = LERP( t, nx0, nx1 );
+
+        nxy0 = grad3(h[4], fx1, fy0, fz0);
+        nxy1 = grad3(h[5], fx1, fy0, fz1);
+        nx0 = LERP( r, nxy0, nxy1 );
+
+        nxy0 = grad3(h[6], fx1, fy1, fz0);
+        nxy1 = grad3(h[7], fx1, fy1, fz1);
+        nx1 = LERP( r, nxy0, nxy1 );
+
+        n1 = LERP( t, nx0, nx1 );
+
+        result[i] = 0.936f * ( LERP( s, n0, n1 ) );
+    }
+}
+
+//---------------------------------------------------------------------
+/** Domain warped 3D Perlin noise.
+ * The warp vector is three channels of noise3() at the same point, from
+ * one shared lookup of the cell, fade weights and corner hashes. Channel 0
+ * would be noise3() itself, so the warp uses channels 1 to 3, which take
+ * the gradient hashes from perm[h+1] to perm[h+3] instead of h. That gives
+ * unrelated gradients at the same lattice points.
+ */
+static void noise3_channels( float x, float y, float z, int first,
+                             float *result )
+{
+    int ix0, iy0, ix1, iy1, iz0, iz1, c, m, hc[8], h[8];
+    float fx0, fy0, fz0, fx1, fy1, fz1;
+    float s, t, r;
+    float nxy0, nxy1, nx0, nx1, n0, n1;
+
+    ix0 = FASTFLOOR( x );
+    iy0 = FASTFLOOR( y );
+    iz0 = FASTFLOOR( z );
+    fx0 = x - ix0;
+    fy0 = y - iy0;
+    fz0 = z - iz0;
+    fx1 = fx0 - 1.0f;
+    fy1 = fy0 - 1.0f;
+    fz1 = fz0 - 1.0f;
+    ix1 = ( ix0 + 1 ) & 0xff;
+    iy1 = ( iy0 + 1 ) & 0xff;
+    iz1 = ( iz0 + 1 ) & 0xff;
+    ix0 = ix0 & 0xff;
+    iy0 = iy0 & 0xff;
+    iz0 = iz0 & 0xff;
+
+    r = FADE( fz0 );
+    t = FADE( fy0 );
+    s = FADE( fx0 );
+
+    h[0] = perm[ix0 + perm[iy0 + perm[iz0]]];
+    h[1] = perm[ix0 + perm[iy0 + perm[iz1]]];
+    h[2] = perm[ix0 + perm[iy1 + perm[iz0]]];
+    h[3] = perm[ix0 + perm[iy1 + perm[iz1]]];
+    h[4] = perm[ix1 + perm[iy0 + perm[iz0]]];
+    h[5] = perm[ix1 + perm[iy0 + perm[iz1]]];
+    h[6] = perm[ix1 + perm[iy1 + perm[iz0]]];
+    h[7] = perm[ix1 + perm[iy1 + perm[iz1]]];
+
+    for( c = 0; c < 3; c++ ) {
+        for( m = 0; m < 8; m++ )
+            hc[m] = ( first + c ) ? perm[h[m] + first + c] : h[m];
+
+        nxy0 = grad3(hc[0], fx0, fy0, fz0);
+        nxy1 = grad3(hc[1], fx0, fy0, fz1);
+        nx0 = LERP( r, nxy0, nxy1 );
+
+        nxy0 = grad3(hc[2], fx0, fy1, fz0);
+        nxy1 = grad3(hc[3], fx0, fy1, fz1);
+        nx1 = LERP( r, nxy0, nxy1 );
+
+        n0 = LERP( t, nx0, nx1 );
+
+        nxy0 = grad3(hc[4], fx1, fy0, fz0);
+        nxy1 = grad3(hc[5], fx1, fy0, fz1);
+        nx0 = LERP( r, nxy0, nxy1 );
+
+        nxy0 = grad3(hc[6], fx1, fy1, fz0);
+        nxy1 = grad3(hc[7], fx1, fy1, fz1);
+        nx1 = LERP( r, nxy0, nxy1 );
+
+        n1 = LERP( t, nx0, nx1 );
+
+        result[c] = 0.936f * ( LERP( s, n0, n1 ) );
+    }
+}
+
+float noise3_warp( float x, float y, float z, float k )
+{
+    float w[3];
+    noise3_channels( x, y, z, 1, w );
+    return noise3( x + k*w[0], y + k*w[1], z + k*w[2] );
+}
+
+void noise3_warp_batch( int n, const float *x, const float *y, const float *z,
+                        float k, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = noise3_warp( x[i], y[i], z[i], k );
+}
+
+//---------------------------------------------------------------------
+/** Classic Perlin noise with analytic derivatives, in 2D to 4D.
+ * The noise is a multilinear interpolation of the corner values with the
+ * fade curve as weights, so its partial derivative along an axis is the
+ * interpolated corner gradients plus the derivative of the fade weight
+ * times the difference across the cell along that axis. All of it is
+ * computed in one pass over the cell corners, and the value is exactly
+ * the same as from noise2() to noise4() or pnoise2() to pnoise4().
+ */
+
+// Derivative of FADE(t)
+#define DFADE(t) ( 30 * t * t * ( t * ( t - 2 ) + 1 ) )
+
+// Collapse 2*n corners to n along one axis with weight w and weight
+// derivative dw. Corners 2c and 2c+1 differ only along that axis, and
+// g[] holds 4 gradient components for each corner.
+static void dlerp_corners( int n, int axis, int dim, float w, float dw,
+                           float *v, float *g )
+{
+    int c, i;
+    for( c = 0; c < n; c++ ) {
+        float v0 = v[2*c], v1 = v[2*c+1];
+        for( i = 0; i < dim; i++ )
+            g[c*4+i] = LERP( w, g[2*c*4+i], g[(2*c+1)*4+i] );
+        g[c*4+axis] += dw * ( v1 - v0 );
+        v[c] = LERP( w, v0, v1 );
+    }
+}
+
+//---------------------------------------------------------------------
+/** Value and gradient of noise2() to noise4().
+ * The helpers below take the wrapped lattice indices of the two sides of
+ * the cell along each axis, so they serve both the plain and the periodic
+ * versions. The corner values are computed with the same grad functions
+ * and interpolated in the same order as in noise2() to noise4().
+ */
+static float dnoise2_cell( int ix0, int iy0, int ix1, int iy1,
+                           float fx0, float fy0, float *grad )
+{
+    float fx1 = fx0 - 1.0f, fy1 = fy0 - 1.0f;
+    float v[4], g[4*4];
+    int h[4], c, i;
+
+    h[0] = perm[ix0 + perm[iy0]];
+    h[1] = perm[ix0 + perm[iy1]];
+    h[2] = perm[ix1 + perm[iy0]];
+    h[3] = perm[ix1 + perm[iy1]];
+    v[0] = grad2(h[0], fx0, fy0);
+    v[1] = grad2(h[1], fx0, fy1);
+    v[2] = grad2(h[2], fx1, fy0);
+    v[3] = grad2(h[3], fx1, fy1);
+    for( c = 0; c < 4; c++ )
+        for( i = 0; i < 2; i++ ) g[c*4+i] = grad2vec[h[c] & 7][i];
+
+    dlerp_corners( 2, 1, 2, FADE( fy0 ), DFADE( fy0 ), v, g );
+    dlerp_corners( 1, 0, 2, FADE( fx0 ), DFADE( fx0 ), v, g );
+    grad[0] = 0.507f * g[0];
+    grad[1] = 0.507f * g[1];
+    return 0.507f * ( v[0] );
+}
+
+static float dnoise3_cell( int ix0, int iy0, int iz0, int ix1, int iy1, int iz1,
+                           float fx0, float fy0, float fz0, float *grad )
+{
+    float fx1 = fx0 - 1.0f, fy1 = fy0 - 1.0f, fz1 = fz0 - 1.0f;
+    float v[8], g[8*4];
+    int h[8], c, i;
+
+    h[0] = perm[ix0 + perm[iy0 + perm[iz0]]];
+    h[1] = perm[ix0 + perm[iy0 + perm[iz1]]];
+    h[2] = perm[ix0 + perm[iy1 + perm[iz0]]];
+    h[3] = perm[ix0 + perm[iy1 + perm[iz1]]];
+    h[4] = perm[ix1 + perm[iy0 + perm[iz0]]];
+    h[5] = perm[ix1 + perm[iy0 + perm[iz1]]];
+    h[6] = perm[ix1 + perm[iy1 + perm[iz0]]];
+    h[7] = perm[ix1 + perm[iy1 + perm[iz1]]];
+    v[0] = grad3(h[0], fx0, fy0, fz0);
+    v[1] = grad3(h[1], fx0, fy0, fz1);
+    v[2] = grad3(h[2], fx0, fy1, fz0);
+    v[3] = grad3(h[3], fx0, fy1, fz1);
+    v[4] = grad3(h[4], fx1, fy0, fz0);
+    v[5] = grad3(h[5], fx1, fy0, fz1);
+    v[6] = grad3(h[6], fx1, fy1, fz0);
+    v[7] = grad3(h[7], fx1, fy1, fz1);
+    for( c = 0; c < 8; c++ )
+        for( i = 0; i < 3; i++ ) g[c*4+i] = grad3vec[h[c] & 15][i];
+
+    dlerp_corners( 4, 2, 3, FADE( fz0 ), DFADE( fz0 ), v, g );
+    dlerp_corners( 2, 1, 3, FADE( fy0 ), DFADE( fy0 ), v, g );
+    dlerp_corners( 1, 0, 3, FADE( fx0 ), DFADE( fx0 ), v, g );
+    grad[0] = 0.936f * g[0];
+    grad[1] = 0.936f * g[1];
+    grad[2] = 0.936f * g[2];
+    return 0.936f * ( v[0] );
+}
+
+static float dnoise4_cell( const int *i0, const int *i1, const float *f0,
+                           float *grad )
+{
+    float f1[4], v[16], g[16*4];
+    int h[16], c, i;
+
+    for( i = 0; i < 4; i++ ) f1[i] = f0[i] - 1.0f;
+    for( c = 0; c < 16; c++ ) { // Corner bits are x, y, z, w from the top
+        int ix = ( c & 8 ) ? i1[0] : i0[0], iy = ( c & 4 ) ? i1[1] : i0[1];
+        int iz = ( c & 2 ) ? i1[2] : i0[2], iw = ( c & 1 ) ? i1[3] : i0[3];
+        h[c] = perm[ix + perm[iy + perm[iz + perm[iw]]]];
+        v[c] = grad4(h[c], ( c & 8 ) ? f1[0] : f0[0], ( c & 4 ) ? f1[1] : f0[1],
+                     ( c & 2 ) ? f1[2] : f0[2], ( c & 1 ) ? f1[3] : f0[3]);
+        for( i = 0; i < 4; i++ ) g[c*4+i] = grad4vec[h[c] & 31][i];
+    }
+
+    dlerp_corners( 8, 3, 4, FADE( f0[3] ), DFADE( f0[3] ), v, g );
+    dlerp_corners( 4, 2, 4, FADE( f0[2] ), DFADE( f0[2] ), v, g );
+    dlerp_corners( 2, 1, 4, FADE( f0[1] ), DFADE( f0[1] ), v, g );
+    dlerp_corners( 1, 0, 4, FADE( f0[0] ), DFADE( f0[0] ), v, g );
+    for( i = 0; i < 4; i++ ) grad[i] = 0.87f * g[i];
+    return 0.87f * ( v[0] );
+}
+
+//---------------------------------------------------------------------
+float dnoise2( float x, float y, float *dnoise_dx, float *dnoise_dy )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y );
+    float g[2], n;
+
+    n = dnoise2_cell( ix0 & 0xff, iy0 & 0xff,
+                      ( ix0 + 1 ) & 0xff, ( iy0 + 1 ) & 0xff,
+                      x - ix0, y - iy0, g );
+    if( dnoise_dx && dnoise_dy ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+    }
+    return n;
+}
+
+float dnoise3( float x, float y, float z,
+               float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y ), iz0 = FASTFLOOR( z );
+    float g[3], n;
+
+    n = dnoise3_cell( ix0 & 0xff, iy0 & 0xff, iz0 & 0xff,
+                      ( ix0 + 1 ) & 0xff, ( iy0 + 1 ) & 0xff,
+                      ( iz0 + 1 ) & 0xff,
+                      x - ix0, y - iy0, z - iz0, g );
+    if( dnoise_dx && dnoise_dy && dnoise_dz ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+        *dnoise_dz = g[2];
+    }
+    return n;
+}
+
+float dnoise4( float x, float y, float z, float w,
+               float *dnoise_dx, float *dnoise_dy,
+               float *dnoise_dz, float *dnoise_dw )
+{
+    float p[4], f0[4], g[4], n;
+    int i0[4], i1[4], a;
+
+    p[0] = x; p[1] = y; p[2] = z; p[3] = w;
+    for( a = 0; a < 4; a++ ) {
+        float pa = p[a];
+        int ia = FASTFLOOR( pa );
+        f0[a] = pa - ia;
+        i0[a] = ia & 0xff;
+        i1[a] = ( ia + 1 ) & 0xff;
+    }
+    n = dnoise4_cell( i0, i1, f0, g );
+    if( dnoise_dx && dnoise_dy && dnoise_dz && dnoise_dw ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+        *dnoise_dz = g[2];
+        *dnoise_dw = g[3];
+    }
+    return n;
+}
+
+//---------------------------------------------------------------------
+/** Value and gradient of pnoise2() to pnoise4().
+ */
+float dpnoise2( float x, float y, int px, int py,
+                float *dnoise_dx, float *dnoise_dy )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y );
+    float g[2], n;
+
+    n = dnoise2_cell( pwrap( ix0, px ) & 0xff, pwrap( iy0, py ) & 0xff,
+                      pwrap( ix0 + 1, px ) & 0xff, pwrap( iy0 + 1, py ) & 0xff,
+                      x - ix0, y - iy0, g );
+    if( dnoise_dx && dnoise_dy ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+    }
+    return n;
+}
+
+float dpnoise3( float x, float y, float z, int px, int py, int pz,
+                float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y ), iz0 = FASTFLOOR( z );
+    float g[3], n;
+
+    n = dnoise3_cell( pwrap( ix0, px ) & 0xff, pwrap( iy0, py ) & 0xff,
+                      pwrap( iz0, pz ) & 0xff,
+                      pwrap( ix0 + 1, px ) & 0xff, pwrap( iy0 + 1, py ) & 0xff,
+                      pwrap( iz0 + 1, pz ) & 0xff,
+                      x - ix0, y - iy0, z - iz0, g );
+    if( dnoise_dx && dnoise_dy && dnoise_dz ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+        *dnoise_dz = g[2];
+    }
+    return n;
+}
+
+float dpnoise4( float x, float y, float z, float w,
+                int px, int py, int pz, int pw,
+                float *dnoise_dx, float *dnoise_dy,
+                float *dnoise_dz, float *dnoise_dw )
+{
+    float p[4], f0[4], g[4], n;
+    int period[4], i0[4], i1[4], a;
+
+    p[0] = x; p[1] = y; p[2] = z; p[3] = w;
+    period[0] = px; period[1] = py; period[2] = pz; period[3] = pw;
+    for( a = 0; a < 4; a++ ) {
+        float pa = p[a];
+        int ia = FASTFLOOR( pa );
+        f0[a] = pa - ia;
+        i0[a] = pwrap( ia, period[a] ) & 0xff;
+        i1[a] = pwrap( ia + 1, period[a] ) & 0xff;
+    }
+    n = dnoise4_cell( i0, i1, f0, g );
+    if( dnoise_dx && dnoise_dy && dnoise_dz && dnoise_dw ) {
+        *dnoise_dx = g[0];
+        *dnoise_dy = g[1];
+        *dnoise_dz = g[2];
+        *dnoise_dw = g[3];
+    }
+    return n;
+}
+
+//---------------------------------------------------------------------
+/** Noise with derivatives over arrays of points. The derivative arrays
+ * may be null, in which case only the values are computed.
+ */
+void dnoise2_batch( int n, const float *x, const float *y, float *result,
+                    float *dnoise_dx, float *dnoise_dy )
+{
+    int i, d = dnoise_dx && dnoise_dy;
+    for( i = 0; i < n; i++ )
+        result[i] = dnoise2( x[i], y[i], d ? dnoise_dx + i : 0,
+                             d ? dnoise_dy + i : 0 );
+}
+
+void dnoise3_batch( int n, const float *x, const float *y, const float *z,
+                    float *result, float *dnoise_dx, float *dnoise_dy,
+                    float *dnoise_dz )
+{
+    int i, d = dnoise_dx && dnoise_dy && dnoise_dz;
+    for( i = 0; i < n; i++ )
+        result[i] = dnoise3( x[i], y[i], z[i], d ? dnoise_dx + i : 0,
+                             d ? dnoise_dy + i : 0, d ? dnoise_dz + i : 0 );
+}
+
+void dnoise4_batch( int n, const float *x, const float *y, const float *z,
+                    const float *w, float *result,
+                    float *dnoise_dx, float *dnoise_dy,
+                    float *dnoise_dz, float *dnoise_dw )
+{
+    int i, d = dnoise_dx && dnoise_dy && dnoise_dz && dnoise_dw;
+    for( i = 0; i < n; i++ )
+        result[i] = dnoise4( x[i], y[i], z[i], w[i],
+                             d ? dnoise_dx + i : 0, d ? dnoise_dy + i : 0,
+                             d ? dnoise_dz + i : 0, d ? dnoise_dw + i : 0 );
+}
+
+void dpnoise2_batch( int n, const float *x, const float *y, int px, int py,
+                     float *result, float *dnoise_dx, float *dnoise_dy )
+{
+    int i, d = dnoise_dx && dnoise_dy;
+    for( i = 0; i < n; i++ )
+        result[i] = dpnoise2( x[i], y[i], px, py, d ? dnoise_dx + i : 0,
+                              d ? dnoise_dy + i : 0 );
+}
+
+void dpnoise3_batch( int n, const float *x, const float *y, const float *z,
+                     int px, int py, int pz, float *result,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    int i, d = dnoise_dx && dnoise_dy && dnoise_dz;
+    for( i = 0; i < n; i++ )
+        result[i] = dpnoise3( x[i], y[i], z[i], px, py, pz,
+                              d ? dnoise_dx + i : 0, d ? dnoise_dy + i : 0,
+                              d ? dnoise_dz + i : 0 );
+}
+
+void dpnoise4_batch( int n, const float *x, const float *y, const float *z,
+                     const float *w, int px, int py, int pz, int pw,
+                     float *result, float *dnoise_dx, float *dnoise_dy,
+                     float *dnoise_dz, float *dnoise_dw )
+{
+    int i, d = dnoise_dx && dnoise_dy && dnoise_dz && dnoise_dw;
+    for( i = 0; i < n; i++ )
+        result[i] = dpnoise4( x[i], y[i], z[i], w[i], px, py, pz, pw,
+                              d ? dnoise_dx + i : 0, d ? dnoise_dy + i : 0,
+                              d ? dnoise_dz + i : 0, d ? dnoise_dw + i : 0 );
+}
+
+//---------------------------------------------------------------------
+/*
+ * Periodic noise with precomputed wrap tables. For a fixed period p, the
+ * wrapped corner indices ( k % p ) & 0xff for k = 0..p are stored in a
+ * table, so the corners of a cell only need the position of the cell
+ * within the period. That is found with a multiplication by 1/p instead
+ * of a division, and the noise is then evaluated by pnoise2_cell() etc.,
+ * which gives values identical to pnoise2() to pnoise4().
+ */
+
+int pnoisetable_init( pnoisetable *pt, int px, int py, int pz, int pw )
+{
+    int a, k;
+
+    pt->period[0] = px; pt->period[1] = py;
+    pt->period[2] = pz; pt->period[3] = pw;
+    for( a = 0; a < 4; a++ )
+        pt->wrap[a] = 0;
+    for( a = 0; a < 4; a++ ) {
+        int p = pt->period[a];
+        if( p <= 0 ) { // This axis is not used
+            pt->period[a] = 0;
+            pt->rperiod[a] = 0.0f;
+            continue;
+        }
+        pt->wrap[a] = (unsigned char *)malloc( p + 1 );
+        if( !pt->wrap[a] ) {
+            pnoisetable_free( pt );
+            return -1;
+        }
+        for( k = 0; k <= p; k++ )
+            pt->wrap[a][k] = ( k % p ) & 0xff;
+        pt->rperiod[a] = 1.0f / p;
+    }
+    return 0;
+}
+
+void pnoisetable_free( pnoisetable *pt )
+{
+    int a;
+    for( a = 0; a < 4; a++ ) {
+        free( pt->wrap[a] );
+        pt->wrap[a] = 0;
+    }
+}
+
+// Position of the lattice coordinate i within the period p, from 0 to
+// p-1. The quotient from the reciprocal can be off by one for rounding,
+// and that is corrected afterwards. Above about 2^24, (float)i is not
+// exact and the quotient can be off by more, so an integer remainder is
+// taken instead whenever the result is still out of range.
+static int ptable_index( int i, int p, float rp )
+{
+    float q = (float)i * rp;
+    int k = i - p * FASTFLOOR( q );
+    if( k < 0 ) k += p;
+    else if( k >= p ) k -= p;
+    if( k < 0 || k >= p ) {
+        k = i % p;
+        if( k < 0 ) k += p;
+    }
+    return k;
+}
+
+//---------------------------------------------------------------------
+/** Periodic noise with the periods of a pnoisetable.
+ */
+float pnoisetable_eval2( const pnoisetable *pt, float x, float y )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y );
+    int kx = ptable_index( ix0, pt->period[0], pt->rperiod[0] );
+    int ky = ptable_index( iy0, pt->period[1], pt->rperiod[1] );
+    const unsigned char *wx = pt->wrap[0], *wy = pt->wrap[1];
+
+    return pnoise2_cell( wx[kx], wy[ky], wx[kx + 1], wy[ky + 1],
+                         x - ix0, y - iy0 );
+}
+
+float pnoisetable_eval3( const pnoisetable *pt, float x, float y, float z )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y ), iz0 = FASTFLOOR( z );
+    int kx = ptable_index( ix0, pt->period[0], pt->rperiod[0] );
+    int ky = ptable_index( iy0, pt->period[1], pt->rperiod[1] );
+    int kz = ptable_index( iz0, pt->period[2], pt->rperiod[2] );
+    const unsigned char *wx = pt->wrap[0], *wy = pt->wrap[1];
+    const unsigned char *wz = pt->wrap[2];
+
+    return pnoise3_cell( wx[kx], wy[ky], wz[kz],
+                         wx[kx + 1], wy[ky + 1], wz[kz + 1],
+                         x - ix0, y - iy0, z - iz0 );
+}
+
+float pnoisetable_eval4( const pnoisetable *pt,
+                         float x, float y, float z, float w )
+{
+    int ix0 = FASTFLOOR( x ), iy0 = FASTFLOOR( y );
+    int iz0 = FASTFLOOR( z ), iw0 = FASTFLOOR( w );
+    int kx = ptable_index( ix0, pt->period[0], pt->rperiod[0] );
+    int ky = ptable_index( iy0, pt->period[1], pt->rperiod[1] );
+    int kz = ptable_index( iz0, pt->period[2], pt->rperiod[2] );
+    int kw = ptable_index( iw0, pt->period[3], pt->rperiod[3] );
+    const unsigned char *wx = pt->wrap[0], *wy = pt->wrap[1];
+    const unsigned char *wz = pt->wrap[2], *ww = pt->wrap[3];
+
+    return pnoise4_cell( wx[kx], wy[ky], wz[kz], ww[kw],
+                         wx[kx + 1], wy[ky + 1], wz[kz + 1], ww[kw + 1],
+                         x - ix0, y - iy0, z - iz0, w - iw0 );
+}
+
+//---------------------------------------------------------------------
+/** Periodic noise over arrays of points.
+ */
+void pnoisetable_eval2_batch( const pnoisetable *pt, int n,
+                              const float *x, const float *y, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = pnoisetable_eval2( pt, x[i], y[i] );
+}
+
+void pnoisetable_eval3_batch( const pnoisetable *pt, int n,
+                              const float *x, const float *y, const float *z,
+                              float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = pnoisetable_eval3( pt, x[i], y[i], z[i] );
+}
+
+void pnoisetable_eval4_batch( const pnoisetable *pt, int n,
+                              const float *x, const float *y, const float *z,
+                              const float *w, float *result )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+        result[i] = pnoisetable_eval4( pt, x[i], y[i], z[i], w[i] );
+}
+
+//---------------------------------------------------------------------
+/** Bake one full period of 2D periodic noise into a tileable texture.
+ */
+void pnoisetable_tile2( const pnoisetable *pt, int width, int height,
+                        float *result )
+{
+    float sx = (float)pt->period[0] / width;
+    float sy = (float)pt->period[1] / height;
+    int i, j;
+
+    for( j = 0; j < height; j++ )
+        for( i = 0; i < width; i++ )
+            result[j*width + i] = pnoisetable_eval2( pt, i * sx, j * sy );
+}
+
+//---------------------------------------------------------------------
+/*
+ * Animated 4D noise at fixed xyz positions. Within one cell, noise4() is
+ * a blend along w of two trilinear blends over xyz, and the gradient ramp
+ * at each of the corners is g.(fx,fy,fz) + gw*fw. With x, y and z fixed,
+ * the xyz blend of those ramps is just another ramp a + b*fw, so the
+ * eight xyz corners of one w plane collapse into two numbers per voxel.
+ * Only the fade along w and the final blend remain for each frame.
+ */
+
+// Wrap a lattice coordinate to 0..255, with a period of 0 meaning none.
+static int anim_wrap( int i, int p ) {
+    return ( ( p > 0 ) ? pwrap( i, p ) : i ) & 0xff;
+}
+
+int noise4anim_init( noise4anim *na, int n, const float *x,
+                     const float *y, const float *z,
+                     int px, int py, int pz, int pw )
+{
+    const float *pos[3];
+    int i, a;
+
+    pos[0] = x; pos[1] = y; pos[2] = z;
+    na->n = n;
+    na->period[0] = px; na->period[1] = py;
+    na->period[2] = pz; na->period[3] = pw;
+    na->corner = (unsigned char *)malloc( 6 * (size_t)n );
+    na->frac = (float *)malloc( 3 * (size_t)n * sizeof(float) );
+    na->ramp[0] = (float *)malloc( 2 * (size_t)n * sizeof(float) );
+    na->ramp[1] = (float *)malloc( 2 * (size_t)n * sizeof(float) );
+    na->rampw[0] = na->rampw[1] = -1;
+    if( !na->corner || !na->frac || !na->ramp[0] || !na->ramp[1] ) {
+        noise4anim_free( na );
+        return -1;
+    }
+
+    for( i = 0; i < n; i++ ) {
+        for( a = 0; a < 3; a++ ) {
+            float v = pos[a][i];
+            int i0 = FASTFLOOR( v );
+            na->corner[6*i + 2*a] = anim_wrap( i0, na->period[a] );
+            na->corner[6*i + 2*a + 1] = anim_wrap( i0 + 1, na->period[a] );
+            na->frac[3*i + a] = v - i0;
+        }
+    }
+    return 0;
+}
+
+void noise4anim_free( noise4anim *na )
+{
+    free( na->corner );
+    free( na->frac );
+    free( na->ramp[0] );
+    free( na->ramp[1] );
+    na->corner = 0;
+    na->frac = 0;
+    na->ramp[0] = na->ramp[1] = 0;
+    na->rampw[0] = na->rampw[1] = -1;
+}
+
+// Compute the ramps of all voxels for the w plane with wrapped index iw,
+// with the xyz blends done in the same order as in noise4().
+static void anim_ramps( const noise4anim *na, int iw, float *ramp )
+{
+    int hw = perm[iw];
+    int i, c;
+
+    for( i = 0; i < na->n; i++ ) {
+        const unsigned char *k = na->corner + 6*i;
+        float fx0 = na->frac[3*i], fy0 = na->frac[3*i + 1];
+        float fz0 = na->frac[3*i + 2];
+        float s = FADE( fx0 ), t = FADE( fy0 ), r = FADE( fz0 );
+        float ga[8], gb[8];
+        float a0, a1, b0, b1;
+
+        for( c = 0; c < 8; c++ ) { // Corner (cx,cy,cz) at c = 4*cx+2*cy+cz
+            int cx = c >> 2, cy = ( c >> 1 ) & 1, cz = c & 1;
+            const signed char *g =
+                grad4vec[perm[k[cx] + perm[k[2 + cy] + perm[k[4 + cz] + hw]]] & 31];
+            ga[c] = g[0]*( fx0 - cx ) + g[1]*( fy0 - cy ) + g[2]*( fz0 - cz );
+            gb[c] = g[3];
+        }
+
+        a0 = LERP( t, LERP( r, ga[0], ga[1] ), LERP( r, ga[2], ga[3] ) );
+        a1 = LERP( t, LERP( r, ga[4], ga[5] ), LERP( r, ga[6], ga[7] ) );
+        b0 = LERP( t, LERP( r, gb[0], gb[1] ), LERP( r, gb[2], gb[3] ) );
+        b1 = LERP( t, LERP( r, gb[4], gb[5] ), LERP( r, gb[6], gb[7] ) );
+        ramp[2*i] = LERP( s, a0, a1 );
+        ramp[2*i + 1] = LERP( s, b0, b1 );
+    }
+}
+
+// Find the ramps for the w plane iw, computing them if they are not
+// cached. The plane keep, which is needed for the same frame, is not
+// replaced.
+static const float *anim_plane( noise4anim *na, int iw, int keep )
+{
+    int slot;
+
+    if( na->rampw[0] == iw ) return na->ramp[0];
+    if( na->rampw[1] == iw ) return na->ramp[1];
+    slot = ( na->rampw[0] == keep ) ? 1 : 0;
+    anim_ramps( na, iw, na->ramp[slot] );
+    na->rampw[slot] = iw;
+    return na->ramp[slot];
+}
+
+void noise4anim_eval( noise4anim *na, float w, float *result )
+{
+    int iw = FASTFLOOR( w );
+    int iw0 = anim_wrap( iw, na->period[3] );
+    int iw1 = anim_wrap( iw + 1, na->period[3] );
+    float fw0 = w - iw;
+    float fw1 = fw0 - 1.0f;
+    float q = FADE( fw0 );
+    const float *r0 = anim_plane( na, iw0, iw1 );
+    const float *r1 = anim_plane( na, iw1, iw0 );
+    int i;
+
+    for( i = 0; i < na->n; i++ )
+        result[i] = 0.87f * LERP( q, r0[2*i] + r0[2*i + 1]*fw0,
+                                     r1[2*i] + r1[2*i + 1]*fw1 );
+}
+
 //---------------------------------------------------------------------
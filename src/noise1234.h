@@ -39,3 +39,214 @@ extern float pnoise2( float x, float y, int px, int py );
 extern float pnoise3( float x, float y, float z, int px, int py, int pz );
 extern float pnoise4( float x, float y, float z, float w,
                               int px, int py, int pz, int pw );
+
+/** 2D and 3D float Perlin noise over arrays of n points.
+ * result[i] is the noise value at (x[i], y[i]) or (x[i], y[i], z[i]).
+ */
+extern void noise2_batch( int n, const float *x, const float *y,
+                          float *result );
+extern void noise3_batch( int n, const float *x, const float *y,
+                          const float *z, float *result );
+
+/** Guaranteed lower and upper bounds for noise3() over the axis-aligned
+ * box [x0,x1]x[y0,y1]x[z0,z1]. The bounds are conservative: every value
+ * of noise3() in the box is within [*nmin, *nmax], but the true range
+ * may be smaller. The cost grows with the number of lattice cells in
+ * the box, up to 512 cells, after which a fixed global bound is returned.
+ * The two corners may be given in either order.
+ */
+extern void noise3_bounds( float x0, float y0, float z0,
+                           float x1, float y1, float z1,
+                           float *nmin, float *nmax );
+
+/** Incremental evaluation of noise3() at points o + t*d along a ray.
+ * The ray remembers the corner hashes of the last lattice cell it was
+ * evaluated in, so consecutive samples within one cell skip the
+ * permutation table lookups. The values are identical to those of
+ * noise3( ox + t*dx, oy + t*dy, oz + t*dz ). Samples can be taken in any
+ * order, but stepping along the ray gives the most reuse. A noise3ray
+ * is not shared between threads; use one for each ray being marched.
+ */
+typedef struct {
+    float ox, oy, oz;       // Ray origin
+    float dx, dy, dz;       // Ray direction
+    int ix, iy, iz;         // Lattice cell of the cached hashes
+    int valid;              // Nonzero when hash[] is for cell (ix,iy,iz)
+    unsigned char hash[8];  // Corner hashes, corner (i,j,k) at [4*i+2*j+k]
+} noise3ray;
+
+extern void noise3ray_init( noise3ray *ray, float ox, float oy, float oz,
+                            float dx, float dy, float dz );
+extern float noise3ray_eval( noise3ray *ray, float t );
+
+/** Evaluate noise3ray_eval() at n steps t0, t0+dt, t0+2*dt, ...
+ */
+extern void noise3ray_march( noise3ray *ray, float t0, float dt, int n,
+                             float *result );
+
+/** 3D float Perlin noise at many points in the same lattice cell, such as
+ * the samples of a supersampled pixel or a super-resolution bake. The
+ * corner gradients of the cell are looked up once, and the points are
+ * evaluated from those alone. noise3_cell_batch() takes the points
+ * relative to the cell (ix,iy,iz), with fx[i], fy[i] and fz[i] in [0,1],
+ * and gives the same values as noise3() with fractional parts fx[i] etc.
+ * in that cell. noise3_grouped_batch() takes ordinary coordinates and
+ * gives values identical to noise3_batch(), looking up the gradients
+ * again each time a point is in another cell than the one before it.
+ * It works for points in any order, but it only pays off when points in
+ * the same cell come in runs, and the speedup grows with the length of
+ * the runs. With one point per cell it is no slower than noise3_batch().
+ */
+extern void noise3_cell_batch( int ix, int iy, int iz, int n,
+                               const float *fx, const float *fy,
+                               const float *fz, float *result );
+extern void noise3_grouped_batch( int n, const float *x, const float *y,
+                                  const float *z, float *result );
+
+/** 2D and 3D float Perlin noise at n points along a line in x:
+ * result[i] is noise2( x + i*dx, y ) or noise3( x + i*dx, y, z ).
+ * The work that is the same for every point of the span is done once,
+ * which makes this a lot faster than separate calls for raster fills.
+ */
+extern void noise2_span( float x, float y, float dx, int n, float *result );
+extern void noise3_span( float x, float y, float z, float dx, int n,
+                         float *result );
+
+/** Domain warped 3D Perlin noise: noise3( p + k*w(p) ), where the warp
+ * vector w is three channels of Perlin noise computed together at p. The
+ * channels use other gradients than noise3() at the same lattice points.
+ * This costs about as much as two calls to noise3() instead of four.
+ */
+extern float noise3_warp( float x, float y, float z, float k );
+extern void noise3_warp_batch( int n, const float *x, const float *y,
+                               const float *z, float k, float *result );
+
+/** 2D, 3D and 4D float Perlin noise with analytic derivatives.
+ * The return value is the same as from noise2() to noise4(), and if the
+ * derivative pointers are not null, the gradient of the noise is also
+ * calculated, in the same pass over the cell.
+ */
+extern float dnoise2( float x, float y, float *dnoise_dx, float *dnoise_dy );
+extern float dnoise3( float x, float y, float z,
+                      float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+extern float dnoise4( float x, float y, float z, float w,
+                      float *dnoise_dx, float *dnoise_dy,
+                      float *dnoise_dz, float *dnoise_dw );
+
+/** 2D, 3D and 4D float Perlin periodic noise with analytic derivatives,
+ * with the same values as pnoise2() to pnoise4().
+ */
+extern float dpnoise2( float x, float y, int px, int py,
+                       float *dnoise_dx, float *dnoise_dy );
+extern float dpnoise3( float x, float y, float z, int px, int py, int pz,
+                       float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+extern float dpnoise4( float x, float y, float z, float w,
+                       int px, int py, int pz, int pw,
+                       float *dnoise_dx, float *dnoise_dy,
+                       float *dnoise_dz, float *dnoise_dw );
+
+/** Noise with derivatives over arrays of n points. The value for point i
+ * goes in result[i] and its gradient in dnoise_dx[i], dnoise_dy[i] etc.
+ * If the derivative arrays are null, only the values are computed.
+ */
+extern void dnoise2_batch( int n, const float *x, const float *y,
+                           float *result,
+                           float *dnoise_dx, float *dnoise_dy );
+extern void dnoise3_batch( int n, const float *x, const float *y,
+                           const float *z, float *result,
+                           float *dnoise_dx, float *dnoise_dy,
+                           float *dnoise_dz );
+extern void dnoise4_batch( int n, const float *x, const float *y,
+                           const float *z, const float *w, float *result,
+                           float *dnoise_dx, float *dnoise_dy,
+                           float *dnoise_dz, float *dnoise_dw );
+extern void dpnoise2_batch( int n, const float *x, const float *y,
+                            int px, int py, float *result,
+                            float *dnoise_dx, float *dnoise_dy );
+extern void dpnoise3_batch( int n, const float *x, const float *y,
+                            const float *z, int px, int py, int pz,
+                            float *result, float *dnoise_dx,
+                            float *dnoise_dy, float *dnoise_dz );
+extern void dpnoise4_batch( int n, const float *x, const float *y,
+                            const float *z, const float *w,
+                            int px, int py, int pz, int pw, float *result,
+                            float *dnoise_dx, float *dnoise_dy,
+                            float *dnoise_dz, float *dnoise_dw );
+
+/** Periodic noise with fixed periods, for baking tileable textures.
+ * pnoisetable_init() precomputes the wrapped lattice indices for the
+ * periods px, py, pz and pw, which replaces the integer divisions that
+ * pnoise2() to pnoise4() do for every corner with table lookups. The
+ * values are identical to those of pnoise2() to pnoise4() with the same
+ * periods. Axes that are not used by the noise that will be evaluated
+ * may be given a period of 0. Returns 0 on success, -1 if out of memory.
+ * As for pnoise2() to pnoise4(), the coordinates must be smaller than
+ * 2^31 in magnitude, so that their floor fits in an int.
+ * A pnoisetable is never modified after it has been set up, so it can
+ * be shared between threads.
+ */
+typedef struct {
+    int period[4];          // Periods along x, y, z and w, 0 if unused
+    float rperiod[4];       // Reciprocals of the periods
+    unsigned char *wrap[4]; // ( k % period ) & 0xff for k = 0..period
+} pnoisetable;
+
+extern int pnoisetable_init( pnoisetable *pt, int px, int py, int pz, int pw );
+extern void pnoisetable_free( pnoisetable *pt );
+
+extern float pnoisetable_eval2( const pnoisetable *pt, float x, float y );
+extern float pnoisetable_eval3( const pnoisetable *pt,
+                                float x, float y, float z );
+extern float pnoisetable_eval4( const pnoisetable *pt,
+                                float x, float y, float z, float w );
+
+/** Periodic noise over arrays of n points.
+ */
+extern void pnoisetable_eval2_batch( const pnoisetable *pt, int n,
+                                     const float *x, const float *y,
+                                     float *result );
+extern void pnoisetable_eval3_batch( const pnoisetable *pt, int n,
+                                     const float *x, const float *y,
+                                     const float *z, float *result );
+extern void pnoisetable_eval4_batch( const pnoisetable *pt, int n,
+                                     const float *x, const float *y,
+                                     const float *z, const float *w,
+                                     float *result );
+
+/** Bake one period of 2D periodic noise into a width x height texture that
+ * tiles seamlessly, stored with x varying fastest: texel (i,j) is at
+ * result[j*width + i] and has the value at (i*px/width, j*py/height).
+ */
+extern void pnoisetable_tile2( const pnoisetable *pt, int width, int height,
+                               float *result );
+
+/** Animated 4D noise over a fixed set of n voxels, for volumes that are
+ * swept along w with small time steps. noise4anim_init() stores the
+ * lattice cell and fade weights of each voxel position (x[i], y[i], z[i])
+ * once. For each lattice plane along w, the eight xyz corners of a voxel
+ * are blended into a single linear ramp a + b*fw, and noise4anim_eval()
+ * only has to blend the ramps of the two planes around w. The ramps are
+ * kept while w stays in the same cell, and a step into the next cell
+ * reuses one of the two planes, so most frames cost a few operations per
+ * voxel. The values are those of pnoise4() with the periods px, py, pz
+ * and pw, except for rounding errors of the order of 1e-6. A period of
+ * 0 means no wrapping along that axis, and with all periods 0 the values
+ * are those of noise4(). A period pw > 0 makes a loop that repeats every
+ * pw units of w. Returns 0 on success, -1 if out of memory.
+ * A noise4anim is updated by noise4anim_eval(), so it should not be
+ * shared between threads.
+ */
+typedef struct {
+    int n;                 // Number of voxels
+    int period[4];         // Periods along x, y, z and w, 0 for no wrapping
+    unsigned char *corner; // Wrapped indices ix0, ix1, iy0, iy1, iz0, iz1
+    float *frac;           // Fractional positions fx, fy, fz
+    float *ramp[2];        // Ramps (a, b) of each voxel for two w planes
+    int rampw[2];          // Wrapped w index of each plane, -1 if unused
+} noise4anim;
+
+extern int noise4anim_init( noise4anim *na, int n, const float *x,
+                            const float *y, const float *z,
+                            int px, int py, int pz, int pw );
+extern void noise4anim_free( noise4anim *na );
+extern void noise4anim_eval( noise4anim *na, float w, float *result );
@@ -0,0 +1,174 @@
+// noiseclipmap
+//
+// Camera-following clipmap of 2D fractal simplex noise, updated
+// incrementally as its center moves.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noiseclipmap.h" for a description. This file needs "fbm.c",
+ * "noise1234.c", "simplexnoise1234.c" and "sdnoise1234.c" to be linked
+ * with it.
+ */
+
+#include <stdlib.h>
+
+#include "fbm.h"
+#include "noiseclipmap.h"
+
+#define FASTFLOOR(x) ( ((int)(x)<=(x)) ? ((int)x) : (((int)x)-1) )
+
+//---------------------------------------------------------------------
+/** Allocate a clipmap.
+ */
+int noiseclipmap_init( noiseclipmap *clip, int levels, int size,
+                       float step, int octaves, float lacunarity,
+                       float gain )
+{
+    int l;
+
+    clip->levels = 0;
+    clip->xbuf = clip->ybuf = clip->vbuf = 0;
+    if( levels < 1 || levels > NOISECLIPMAP_MAXLEVELS || size < 1 )
+        return -1;
+
+    clip->size = size;
+    clip->step = step;
+    clip->octaves = octaves;
+    clip->lacunarity = lacunarity;
+    clip->gain = gain;
+    clip->valid = 0;
+
+    for( l = 0; l < levels; l++ ) {
+        clip->ox[l] = clip->oy[l] = 0;
+        clip->data[l] = (float *)malloc( sizeof(float) * size * size );
+        clip->levels = l + 1;
+        if( !clip->data[l] ) {
+            noiseclipmap_free( clip );
+            return -1;
+        }
+    }
+    clip->xbuf = (float *)malloc( sizeof(float) * size );
+    clip->ybuf = (float *)malloc( sizeof(float) * size );
+    clip->vbuf = (float *)malloc( sizeof(float) * size );
+    if( !clip->xbuf || !clip->ybuf || !clip->vbuf ) {
+        noiseclipmap_free( clip );
+        return -1;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------
+/** Free the memory held by a clipmap.
+ */
+void noiseclipmap_free( noiseclipmap *clip )
+{
+    int l;
+
+    for( l = 0; l < clip->levels; l++ ) {
+        free( clip->data[l] );
+        clip->data[l] = 0;
+    }
+    free( clip->xbuf );
+    free( clip->ybuf );
+    free( clip->vbuf );
+    clip->xbuf = clip->ybuf = clip->vbuf = 0;
+    clip->levels = 0;
+    clip->valid = 0;
+}
+
+//---------------------------------------------------------------------
+
+// Index 0..m-1 of i modulo m, also for negative i
+static int wrap( int i, int m )
+{
+    i %= m;
+    return ( i < 0 ) ? i + m : i;
+}
+
+// Generate world texels i0..i1-1 of row j at level l, with one batch call
+static void fill_run( noiseclipmap *clip, int l, float lstep,
+                      int i0, int i1, int j )
+{
+    int n = i1 - i0, k, m, row;
+    float *dst;
+
+    for( k = 0; k < n; k++ ) {
+        clip->xbuf[k] = ( i0 + k ) * lstep;
+        clip->ybuf[k] = j * lstep;
+    }
+    sfbm2_batch( n, clip->xbuf, clip->ybuf,
+                 clip->octaves, clip->lacunarity, clip->gain, clip->vbuf );
+
+    row = wrap( j, clip->size ) * clip->size;
+    dst = clip->data[l] + row;
+    k = wrap( i0, clip->size );
+    for( m = 0; m < n; m++ ) { // The run may wrap around the row end
+        dst[k] = clip->vbuf[m];
+        if( ++k == clip->size ) k = 0;
+    }
+}
+
+//---------------------------------------------------------------------
+/** Center all levels on (x,y) and generate the newly exposed texels.
+ */
+long noiseclipmap_update( noiseclipmap *clip, float x, float y )
+{
+    int size = clip->size, l, j, nox, noy, dx, dy;
+    int rlo, rhi, clo, chi;
+    float lstep = clip->step, fx, fy;
+    long count = 0;
+
+    for( l = 0; l < clip->levels; l++, lstep *= 2.0f ) {
+        fx = x / lstep;
+        fy = y / lstep;
+        nox = FASTFLOOR( fx ) - size / 2;
+        noy = FASTFLOOR( fy ) - size / 2;
+        dx = nox - clip->ox[l];
+        dy = noy - clip->oy[l];
+
+        if( !clip->valid || dx <= -size || dx >= size
+            || dy <= -size || dy >= size ) {
+            // Nothing to keep, fill the whole level
+            for( j = noy; j < noy + size; j++ )
+                fill_run( clip, l, lstep, nox, nox + size, j );
+            count += (long)size * size;
+        }
+        else {
+            // Rows that came into view, over the full new width
+            rlo = ( dy > 0 ) ? clip->oy[l] + size : noy;
+            rhi = ( dy > 0 ) ? noy + size : clip->oy[l];
+            for( j = rlo; j < rhi; j++ )
+                fill_run( clip, l, lstep, nox, nox + size, j );
+            count += (long)( rhi - rlo ) * size;
+
+            // Columns that came into view, over the rows that were kept
+            clo = ( dx > 0 ) ? clip->ox[l] + size : nox;
+            chi = ( dx > 0 ) ? nox + size : clip->ox[l];
+            if( chi > clo ) {
+                rlo = ( dy > 0 ) ? noy : clip->oy[l];
+                rhi = ( dy > 0 ) ? clip->oy[l] + size : noy + size;
+                for( j = rlo; j < rhi; j++ )
+                    fill_run( clip, l, lstep, clo, chi, j );
+                count += (long)( rhi - rlo ) * ( chi - clo );
+            }
+        }
+        clip->ox[l] = nox;
+        clip->oy[l] = noy;
+    }
+    clip->valid = 1;
+    return count;
+}
+
+//---------------------------------------------------------------------
+/** Texel (i,j) of level l, relative to the lowest corner of the level.
+ */
+float noiseclipmap_texel( const noiseclipmap *clip, int l, int i, int j )
+{
+    int size = clip->size;
+    return clip->data[l][ wrap( clip->oy[l] + j, size ) * size
+                          + wrap( clip->ox[l] + i, size ) ];
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,62 @@
+// noiseclipmap
+//
+// Camera-following clipmap of 2D fractal simplex noise, updated
+// incrementally as its center moves.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * A clipmap is a stack of square levels of size x size texels, all
+ * centered on the same point. Texels of level l are step*2^l apart, so
+ * each level covers twice the area of the one before it at half the
+ * resolution. Texel (i,j) of the world grid of level l holds
+ * sfbm2( i*step*2^l, j*step*2^l ) (see "fbm.h").
+ *
+ * The levels are addressed toroidally: world texel (i,j) is stored at
+ * data[l][(j mod size)*size + (i mod size)], so when the center moves,
+ * texels that stay inside a level keep their place in memory. Only the
+ * rows and columns that come into view are generated, and the cost of an
+ * update grows with the distance moved rather than with the level size.
+ * Every texel is computed from its world index alone, so the contents
+ * are the same as after a full regeneration at the new position.
+ */
+
+#define NOISECLIPMAP_MAXLEVELS 16
+
+typedef struct {
+    int levels;                           // Number of levels
+    int size;                             // Texels along each side of a level
+    float step;                           // Texel spacing of level 0
+    int octaves;                          // fBm parameters, see "fbm.h"
+    float lacunarity, gain;
+    int valid;                            // Nonzero once the levels are filled
+    int ox[NOISECLIPMAP_MAXLEVELS];       // World index of the lowest texel
+    int oy[NOISECLIPMAP_MAXLEVELS];       // in x and y for each level
+    float *data[NOISECLIPMAP_MAXLEVELS];  // size*size texels for each level
+    float *xbuf, *ybuf, *vbuf;            // Scratch rows for batch evaluation
+} noiseclipmap;
+
+/** Allocate a clipmap. Nothing is generated until the first update.
+ * Returns 0 on success, or -1 if out of memory or if levels is not in
+ * the range 1..NOISECLIPMAP_MAXLEVELS.
+ */
+extern int noiseclipmap_init( noiseclipmap *clip, int levels, int size,
+                              float step, int octaves, float lacunarity,
+                              float gain );
+
+/** Free the memory held by a clipmap.
+ */
+extern void noiseclipmap_free( noiseclipmap *clip );
+
+/** Center all levels on (x,y), generating the texels that come into view.
+ * The first call fills every level. Returns the number of texels that
+ * were generated.
+ */
+extern long noiseclipmap_update( noiseclipmap *clip, float x, float y );
+
+/** Texel (i,j) of level l, counted from the lowest corner of the level
+ * at (ox[l], oy[l]), for i and j in 0..size-1.
+ */
+extern float noiseclipmap_texel( const noiseclipmap *clip, int l,
+                                 int i, int j );
@@ -0,0 +1,196 @@
+// noiseflow
+//
+// Multi-threaded advection of particles through curl noise.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noiseflow.h" for a description.
+ */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "sdnoise1234.h"
+#include "srdnoise23.h"
+#include "noiseflow.h"
+
+#define CHUNK NOISEFLOW_CHUNK
+
+// Offsets of the second and third channel of NOISEFLOW_FLOW. Any offsets
+// that are large compared to a lattice cell give independent channels.
+#define FLOW_OFFSET1 31.416f
+#define FLOW_OFFSET2 -47.853f
+
+//---------------------------------------------------------------------
+
+static int flow_threads( int nthreads )
+{
+#ifdef _OPENMP
+    if( nthreads <= 0 ) nthreads = omp_get_max_threads();
+#endif
+    return ( nthreads > 0 ) ? nthreads : 1;
+}
+
+// Velocity at up to CHUNK points. rg holds the rotated gradients for
+// NOISEFLOW_FLOW, and is not used for NOISEFLOW_CURL.
+static void flow_chunk( const noiseflow *nf, const srdgrad3 *rg, int n,
+                        const float *x, const float *y, const float *z,
+                        float *vx, float *vy, float *vz )
+{
+    float sx[CHUNK], sy[CHUNK], sz[CHUNK], psi[CHUNK];
+    float J[9*CHUNK]; // Derivative of channel c along axis a at [9*i+3*c+a]
+    int i, c;
+
+    for( i = 0; i < n; i++ ) {
+        sx[i] = nf->frequency * x[i];
+        sy[i] = nf->frequency * y[i];
+        sz[i] = nf->frequency * z[i];
+    }
+
+    if( nf->field == NOISEFLOW_FLOW ) {
+        float gx[CHUNK], gy[CHUNK], gz[CHUNK];
+        for( c = 0; c < 3; c++ ) {
+            if( c > 0 ) { // Move to the next channel
+                float d = ( c == 1 ) ? FLOW_OFFSET1 : FLOW_OFFSET2 - FLOW_OFFSET1;
+                for( i = 0; i < n; i++ ) {
+                    sx[i] += d;
+                    sy[i] += d;
+                    sz[i] += d;
+                }
+            }
+            srdnoise3_rot_batch( rg, n, sx, sy, sz, psi, gx, gy, gz );
+            for( i = 0; i < n; i++ ) {
+                J[9*i + 3*c] = gx[i];
+                J[9*i + 3*c + 1] = gy[i];
+                J[9*i + 3*c + 2] = gz[i];
+            }
+        }
+    }
+    else {
+        // The channel values are not needed, only their derivatives
+        float psi1[CHUNK], psi2[CHUNK];
+        sdnoise3_vec3_batch( n, sx, sy, sz, psi, psi1, psi2, J );
+    }
+
+    for( i = 0; i < n; i++ ) {
+        const float *j = J + 9*i;
+        vx[i] = nf->speed * ( j[7] - j[5] ); // dpsi2/dy - dpsi1/dz
+        vy[i] = nf->speed * ( j[2] - j[6] ); // dpsi0/dz - dpsi2/dx
+        vz[i] = nf->speed * ( j[3] - j[1] ); // dpsi1/dx - dpsi0/dy
+    }
+}
+
+//---------------------------------------------------------------------
+/** Velocity of the field, one chunk per task.
+ */
+void noiseflow_velocity( const noiseflow *nf, int n,
+                         const float *x, const float *y, const float *z,
+                         float *vx, float *vy, float *vz )
+{
+    int nchunks = ( n + CHUNK - 1 ) / CHUNK;
+    int nthreads = flow_threads( nf->nthreads );
+    srdgrad3 rg;
+    int c;
+
+    (void)nthreads; // Only read by OpenMP
+    if( nf->field == NOISEFLOW_FLOW ) srdgrad3_set( &rg, nf->angle );
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for( c = 0; c < nchunks; c++ )
+    {
+        int i0 = c * CHUNK;
+        int m = ( n - i0 < CHUNK ) ? n - i0 : CHUNK;
+        flow_chunk( nf, &rg, m, x + i0, y + i0, z + i0,
+                    vx + i0, vy + i0, vz + i0 );
+    }
+}
+
+//---------------------------------------------------------------------
+/** Advance the particles, one chunk per task. The stages of the
+ * Runge-Kutta methods are evaluated for the whole chunk at a time.
+ */
+void noiseflow_advect( const noiseflow *nf, int n,
+                       float *x, float *y, float *z,
+                       float *vx, float *vy, float *vz, float dt )
+{
+    int nchunks = ( n + CHUNK - 1 ) / CHUNK;
+    int nthreads = flow_threads( nf->nthreads );
+    srdgrad3 rg;
+    int c;
+
+    (void)nthreads; // Only read by OpenMP
+    if( nf->field == NOISEFLOW_FLOW ) srdgrad3_set( &rg, nf->angle );
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for( c = 0; c < nchunks; c++ )
+    {
+        float kx[CHUNK], ky[CHUNK], kz[CHUNK];    // Velocity of a stage
+        float sx[CHUNK], sy[CHUNK], sz[CHUNK];    // Sum of the stages
+        float px[CHUNK], py[CHUNK], pz[CHUNK];    // Position of a stage
+        float *cx = x + c * CHUNK, *cy = y + c * CHUNK, *cz = z + c * CHUNK;
+        int m = ( n - c * CHUNK < CHUNK ) ? n - c * CHUNK : CHUNK;
+        int i;
+
+        flow_chunk( nf, &rg, m, cx, cy, cz, kx, ky, kz );
+
+        if( nf->method == NOISEFLOW_RK2 ) {
+            for( i = 0; i < m; i++ ) {
+                px[i] = cx[i] + 0.5f * dt * kx[i];
+                py[i] = cy[i] + 0.5f * dt * ky[i];
+                pz[i] = cz[i] + 0.5f * dt * kz[i];
+            }
+            flow_chunk( nf, &rg, m, px, py, pz, kx, ky, kz );
+        }
+        else if( nf->method == NOISEFLOW_RK4 ) {
+            // k1 is in kx, ky, kz. Stages 2 and 3 are taken from the
+            // midpoint, stage 4 from the end point, and the weights of
+            // the stages are 1, 2, 2, 1 over 6.
+            static const float step[3] = { 0.5f, 0.5f, 1.0f };
+            static const float weight[3] = { 2.0f, 2.0f, 1.0f };
+            int s;
+            for( i = 0; i < m; i++ ) {
+                sx[i] = kx[i];
+                sy[i] = ky[i];
+                sz[i] = kz[i];
+            }
+            for( s = 0; s < 3; s++ ) {
+                float h = step[s] * dt;
+                for( i = 0; i < m; i++ ) {
+                    px[i] = cx[i] + h * kx[i];
+                    py[i] = cy[i] + h * ky[i];
+                    pz[i] = cz[i] + h * kz[i];
+                }
+                flow_chunk( nf, &rg, m, px, py, pz, kx, ky, kz );
+                for( i = 0; i < m; i++ ) {
+                    sx[i] += weight[s] * kx[i];
+                    sy[i] += weight[s] * ky[i];
+                    sz[i] += weight[s] * kz[i];
+                }
+            }
+            for( i = 0; i < m; i++ ) {
+                kx[i] = sx[i] * ( 1.0f / 6.0f );
+                ky[i] = sy[i] * ( 1.0f / 6.0f );
+                kz[i] = sz[i] * ( 1.0f / 6.0f );
+            }
+        }
+
+        // Move by the step velocity, which is in kx, ky, kz for all methods
+        for( i = 0; i < m; i++ ) {
+            cx[i] += dt * kx[i];
+            cy[i] += dt * ky[i];
+            cz[i] += dt * kz[i];
+        }
+        if( vx && vy && vz ) {
+            for( i = 0; i < m; i++ ) {
+                vx[c * CHUNK + i] = kx[i];
+                vy[c * CHUNK + i] = ky[i];
+                vz[c * CHUNK + i] = kz[i];
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,114 @@
+// noisegen
+//
+// Chunked, multi-threaded generation of 2D and 3D noise grids.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noisegen.h" for a description. This file does not depend on any
+ * particular noise function, it only calls the batch function it is given.
+ */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <stddef.h>
+
+#include "noisegen.h"
+
+// Chunk sizes. A chunk of 64x64 or 16x16x16 floats is 16 KB, which
+// stays in the L1 or L2 cache while it is being written.
+#define CHUNK2 64
+#define CHUNK3 16
+
+//---------------------------------------------------------------------
+
+static int gen_threads( int nthreads )
+{
+#ifdef _OPENMP
+    if( nthreads <= 0 ) nthreads = omp_get_max_threads();
+#endif
+    return ( nthreads > 0 ) ? nthreads : 1;
+}
+
+//---------------------------------------------------------------------
+/** Fill a 2D grid with noise, one 64x64 chunk per task.
+ */
+void noisegen2( noisebatch2 func, float *out, int width, int height,
+                float x0, float y0, float step, int nthreads )
+{
+    int cw = ( width + CHUNK2 - 1 ) / CHUNK2;  // Chunks per row
+    int ch = ( height + CHUNK2 - 1 ) / CHUNK2; // Chunks per column
+    int nchunks = cw * ch;
+    int c;
+
+    nthreads = gen_threads( nthreads );
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for( c = 0; c < nchunks; c++ )
+    {
+        float xs[CHUNK2], ys[CHUNK2];
+        int i0 = ( c % cw ) * CHUNK2;
+        int j0 = ( c / cw ) * CHUNK2;
+        int n = ( width - i0 < CHUNK2 ) ? width - i0 : CHUNK2;
+        int jn = ( height - j0 < CHUNK2 ) ? height - j0 : CHUNK2;
+        int i, j;
+
+        for( i = 0; i < n; i++ )
+            xs[i] = x0 + ( i0 + i ) * step;
+        for( j = j0; j < j0 + jn; j++ )
+        {
+            float y = y0 + j * step;
+            for( i = 0; i < n; i++ ) ys[i] = y;
+            func( n, xs, ys, out + (size_t)j * width + i0 );
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+/** Fill a 3D grid with noise, one 16x16x16 chunk per task.
+ */
+void noisegen3( noisebatch3 func, float *out,
+                int width, int height, int depth,
+                float x0, float y0, float z0, float step, int nthreads )
+{
+    int cw = ( width + CHUNK3 - 1 ) / CHUNK3;
+    int ch = ( height + CHUNK3 - 1 ) / CHUNK3;
+    int cd = ( depth + CHUNK3 - 1 ) / CHUNK3;
+    int nchunks = cw * ch * cd;
+    int c;
+
+    nthreads = gen_threads( nthreads );
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for( c = 0; c < nchunks; c++ )
+    {
+        float xs[CHUNK3], ys[CHUNK3], zs[CHUNK3];
+        int i0 = ( c % cw ) * CHUNK3;
+        int j0 = ( ( c / cw ) % ch ) * CHUNK3;
+        int k0 = ( c / ( cw * ch ) ) * CHUNK3;
+        int n = ( width - i0 < CHUNK3 ) ? width - i0 : CHUNK3;
+        int jn = ( height - j0 < CHUNK3 ) ? height - j0 : CHUNK3;
+        int kn = ( depth - k0 < CHUNK3 ) ? depth - k0 : CHUNK3;
+        int i, j, k;
+
+        for( i = 0; i < n; i++ )
+            xs[i] = x0 + ( i0 + i ) * step;
+        for( k = k0; k < k0 + kn; k++ )
+        {
+            float z = z0 + k * step;
+            for( i = 0; i < n; i++ ) zs[i] = z;
+            for( j = j0; j < j0 + jn; j++ )
+            {
+                float y = y0 + j * step;
+                for( i = 0; i < n; i++ ) ys[i] = y;
+                func( n, xs, ys, zs,
+                      out + ( (size_t)k * height + j ) * width + i0 );
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,46 @@
+// noisegen
+//
+// Chunked, multi-threaded generation of 2D and 3D noise grids.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * The grid is split into cache-sized chunks (64x64 samples in 2D,
+ * 16x16x16 samples in 3D) which are handed out to the worker threads
+ * one at a time, so a thread that finishes early just picks up the next
+ * chunk. Each chunk is filled one row at a time by a batch noise function
+ * such as noise2_batch() or snoise3_batch().
+ *
+ * Every sample is computed from its own grid index only, so the result
+ * is bit-identical for any number of threads, including one.
+ *
+ * Threading uses OpenMP. Compile with OpenMP enabled (-fopenmp or /openmp)
+ * to run in parallel. Without it, the same code runs on a single thread.
+ */
+
+/** Batch noise functions, with the same signature as noise2_batch(),
+ * snoise2_batch(), noise3_batch() and snoise3_batch().
+ */
+typedef void (*noisebatch2)( int n, const float *x, const float *y,
+                             float *result );
+typedef void (*noisebatch3)( int n, const float *x, const float *y,
+                             const float *z, float *result );
+
+/** Fill a width x height grid with 2D noise.
+ * Sample (i,j) is evaluated at (x0 + i*step, y0 + j*step) and stored
+ * in out[j*width + i]. If nthreads is zero or negative, all available
+ * processors are used.
+ */
+extern void noisegen2( noisebatch2 func, float *out, int width, int height,
+                       float x0, float y0, float step, int nthreads );
+
+/** Fill a width x height x depth grid with 3D noise.
+ * Sample (i,j,k) is evaluated at (x0 + i*step, y0 + j*step, z0 + k*step)
+ * and stored in out[(k*height + j)*width + i]. If nthreads is zero or
+ * negative, all available processors are used.
+ */
+extern void noisegen3( noisebatch3 func, float *out,
+                       int width, int height, int depth,
+                       float x0, float y0, float z0, float step,
+                       int nthreads );
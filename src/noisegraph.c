@@ -0,0 +1,264 @@
+// noisegraph
+//
+// Noise expressions built as small node graphs and evaluated in tiles,
+// without a full intermediate buffer for every node.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noisegraph.h" for a description. This file needs "fbm.c" and the
+ * noise files it depends on to be linked with it.
+ */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "noise1234.h"
+#include "simplexnoise1234.h"
+#include "fbm.h"
+#include "noisegraph.h"
+
+//---------------------------------------------------------------------
+/** Start a new graph.
+ */
+void noisegraph_init( noisegraph *g )
+{
+    g->count = 0;
+}
+
+//---------------------------------------------------------------------
+
+// Append a node, after checking that its inputs are earlier nodes
+static int add_node( noisegraph *g, int op, int a, int b, int c, int ninputs,
+                     float p0, float p1 )
+{
+    noisegraph_node *node;
+
+    if( g->count >= NOISEGRAPH_MAXNODES ) return -1;
+    if( ninputs > 0 && ( a < 0 || a >= g->count ) ) return -1;
+    if( ninputs > 1 && ( b < 0 || b >= g->count ) ) return -1;
+    if( ninputs > 2 && ( c < 0 || c >= g->count ) ) return -1;
+
+    node = &g->node[g->count];
+    node->op = op;
+    node->a = ( ninputs > 0 ) ? a : -1;
+    node->b = ( ninputs > 1 ) ? b : -1;
+    node->c = ( ninputs > 2 ) ? c : -1;
+    node->octaves = 0;
+    node->p0 = p0;
+    node->p1 = p1;
+    return g->count++;
+}
+
+/** Node constructors.
+ */
+int noisegraph_coord( noisegraph *g, int axis )
+{
+    if( axis < 0 || axis > 2 ) return -1;
+    return add_node( g, NOISEGRAPH_X + axis, -1, -1, -1, 0, 0.0f, 0.0f );
+}
+
+int noisegraph_const( noisegraph *g, float value )
+{
+    return add_node( g, NOISEGRAPH_CONST, -1, -1, -1, 0, value, 0.0f );
+}
+
+int noisegraph_binary( noisegraph *g, int op, int a, int b )
+{
+    if( op < NOISEGRAPH_ADD || op > NOISEGRAPH_MAX ) return -1;
+    return add_node( g, op, a, b, -1, 2, 0.0f, 0.0f );
+}
+
+int noisegraph_scale( noisegraph *g, int a, float scale, float bias )
+{
+    return add_node( g, NOISEGRAPH_SCALE, a, -1, -1, 1, scale, bias );
+}
+
+int noisegraph_abs( noisegraph *g, int a )
+{
+    return add_node( g, NOISEGRAPH_ABS, a, -1, -1, 1, 0.0f, 0.0f );
+}
+
+int noisegraph_ridge( noisegraph *g, int a, float offset )
+{
+    return add_node( g, NOISEGRAPH_RIDGE, a, -1, -1, 1, offset, 0.0f );
+}
+
+int noisegraph_clamp( noisegraph *g, int a, float lo, float hi )
+{
+    return add_node( g, NOISEGRAPH_CLAMP, a, -1, -1, 1, lo, hi );
+}
+
+int noisegraph_lerp( noisegraph *g, int a, int b, int t )
+{
+    return add_node( g, NOISEGRAPH_LERP, a, b, t, 3, 0.0f, 0.0f );
+}
+
+int noisegraph_noise( noisegraph *g, int op, int x, int y, int z )
+{
+    if( op != NOISEGRAPH_NOISE3 && op != NOISEGRAPH_SNOISE3 ) return -1;
+    return add_node( g, op, x, y, z, 3, 0.0f, 0.0f );
+}
+
+int noisegraph_fbm( noisegraph *g, int op, int x, int y, int z,
+                    int octaves, float lacunarity, float gain )
+{
+    int i;
+
+    if( op != NOISEGRAPH_FBM3 && op != NOISEGRAPH_SFBM3 ) return -1;
+    i = add_node( g, op, x, y, z, 3, lacunarity, gain );
+    if( i >= 0 ) g->node[i].octaves = octaves;
+    return i;
+}
+
+//---------------------------------------------------------------------
+
+// Evaluate one node over a tile of n points. r is the result, and a, b, c
+// are the tiles of the inputs.
+static void eval_node( const noisegraph_node *node, int n, float *r,
+                       const float *a, const float *b, const float *c,
+                       const float *x, const float *y, const float *z )
+{
+    float p0 = node->p0, p1 = node->p1;
+    int i;
+
+    switch( node->op ) {
+    case NOISEGRAPH_X:
+        for( i = 0; i < n; i++ ) r[i] = x[i];
+        break;
+    case NOISEGRAPH_Y:
+        for( i = 0; i < n; i++ ) r[i] = y[i];
+        break;
+    case NOISEGRAPH_Z:
+        for( i = 0; i < n; i++ ) r[i] = z[i];
+        break;
+    case NOISEGRAPH_CONST:
+        for( i = 0; i < n; i++ ) r[i] = p0;
+        break;
+    case NOISEGRAPH_ADD:
+        for( i = 0; i < n; i++ ) r[i] = a[i] + b[i];
+        break;
+    case NOISEGRAPH_SUB:
+        for( i = 0; i < n; i++ ) r[i] = a[i] - b[i];
+        break;
+    case NOISEGRAPH_MUL:
+        for( i = 0; i < n; i++ ) r[i] = a[i] * b[i];
+        break;
+    case NOISEGRAPH_MIN:
+        for( i = 0; i < n; i++ ) r[i] = ( a[i] < b[i] ) ? a[i] : b[i];
+        break;
+    case NOISEGRAPH_MAX:
+        for( i = 0; i < n; i++ ) r[i] = ( a[i] > b[i] ) ? a[i] : b[i];
+        break;
+    case NOISEGRAPH_SCALE:
+        for( i = 0; i < n; i++ ) r[i] = a[i] * p0 + p1;
+        break;
+    case NOISEGRAPH_ABS:
+        for( i = 0; i < n; i++ ) r[i] = ( a[i] < 0.0f ) ? -a[i] : a[i];
+        break;
+    case NOISEGRAPH_RIDGE:
+        for( i = 0; i < n; i++ ) r[i] = p0 - ( ( a[i] < 0.0f ) ? -a[i] : a[i] );
+        break;
+    case NOISEGRAPH_CLAMP:
+        for( i = 0; i < n; i++ )
+            r[i] = ( a[i] < p0 ) ? p0 : ( a[i] > p1 ) ? p1 : a[i];
+        break;
+    case NOISEGRAPH_LERP:
+        for( i = 0; i < n; i++ ) r[i] = a[i] + c[i] * ( b[i] - a[i] );
+        break;
+    case NOISEGRAPH_NOISE3:
+        noise3_batch( n, a, b, c, r );
+        break;
+    case NOISEGRAPH_SNOISE3:
+        snoise3_batch( n, a, b, c, r );
+        break;
+    case NOISEGRAPH_FBM3:
+        for( i = 0; i < n; i++ )
+            r[i] = fbm3( a[i], b[i], c[i], node->octaves, p0, p1 );
+        break;
+    case NOISEGRAPH_SFBM3:
+        for( i = 0; i < n; i++ )
+            r[i] = sfbm3( a[i], b[i], c[i], node->octaves, p0, p1 );
+        break;
+    }
+}
+
+//---------------------------------------------------------------------
+/** Evaluate a graph over arrays of points, one tile at a time.
+ */
+int noisegraph_eval( const noisegraph *g, int out, int n,
+                     const float *x, const float *y, const float *z,
+                     float *result, int nthreads )
+{
+    int used[NOISEGRAPH_MAXNODES];  // Nonzero for nodes that out needs
+    int last[NOISEGRAPH_MAXNODES];  // Last node that reads each node
+    int slot[NOISEGRAPH_MAXNODES];  // Tile buffer of each node
+    int freeslot[NOISEGRAPH_MAXNODES], nfree = 0, nslots = 0;
+    int ntiles, t, i, k;
+
+    if( out < 0 || out >= g->count ) return -1;
+
+    // Find the nodes that out depends on, and where each is last read
+    for( i = 0; i <= out; i++ ) used[i] = 0;
+    used[out] = 1;
+    last[out] = out;
+    for( i = out; i >= 0; i-- ) {
+        const noisegraph_node *node = &g->node[i];
+        int in[3];
+        if( !used[i] ) continue;
+        in[0] = node->a; in[1] = node->b; in[2] = node->c;
+        for( k = 0; k < 3; k++ ) {
+            if( in[k] < 0 ) continue;
+            if( !used[in[k]] ) last[in[k]] = i; // Visited in reverse order
+            used[in[k]] = 1;
+        }
+    }
+
+    // Assign tile buffers, reusing each one after its last reader
+    for( i = 0; i <= out; i++ ) {
+        const noisegraph_node *node = &g->node[i];
+        int in[3];
+        if( !used[i] ) continue;
+        slot[i] = ( nfree > 0 ) ? freeslot[--nfree] : nslots++;
+        in[0] = node->a; in[1] = node->b; in[2] = node->c;
+        for( k = 0; k < 3; k++ ) {
+            int m;
+            if( in[k] < 0 || last[in[k]] != i ) continue;
+            for( m = 0; m < k; m++ ) if( in[m] == in[k] ) break;
+            if( m == k ) freeslot[nfree++] = slot[in[k]];
+        }
+    }
+
+#ifdef _OPENMP
+    if( nthreads <= 0 ) nthreads = omp_get_max_threads();
+#endif
+    if( nthreads <= 0 ) nthreads = 1;
+
+    ntiles = ( n + NOISEGRAPH_TILE - 1 ) / NOISEGRAPH_TILE;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for( t = 0; t < ntiles; t++ )
+    {
+        float buf[NOISEGRAPH_MAXNODES][NOISEGRAPH_TILE];
+        int i0 = t * NOISEGRAPH_TILE;
+        int tn = ( n - i0 < NOISEGRAPH_TILE ) ? n - i0 : NOISEGRAPH_TILE;
+        int j;
+
+        for( j = 0; j <= out; j++ ) {
+            const noisegraph_node *node = &g->node[j];
+            if( !used[j] ) continue;
+            eval_node( node, tn, buf[slot[j]],
+                       ( node->a >= 0 ) ? buf[slot[node->a]] : 0,
+                       ( node->b >= 0 ) ? buf[slot[node->b]] : 0,
+                       ( node->c >= 0 ) ? buf[slot[node->c]] : 0,
+                       x + i0, y + i0, z + i0 );
+        }
+        for( j = 0; j < tn; j++ )
+            result[i0 + j] = buf[slot[out]][j];
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,88 @@
+// noisegraph
+//
+// Noise expressions built as small node graphs and evaluated in tiles,
+// without a full intermediate buffer for every node.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * A graph is built by adding nodes one at a time. Each function that adds
+ * a node returns its index, which is then used as an input to later
+ * nodes, so an expression like
+ *
+ *   clamp( sfbm3(p) + 0.5*ridge(snoise3(2p)), 0, 1 ) * mask
+ *
+ * is built from the inside out. Nodes can only refer to nodes added before
+ * them, so the graph is always in evaluation order. If a node cannot be
+ * added, because the graph is full or an input is invalid, -1 is returned,
+ * and any node built on top of that also returns -1.
+ *
+ * noisegraph_eval() works through the points in tiles of NOISEGRAPH_TILE
+ * points. For each tile, every node is evaluated in turn over the whole
+ * tile, as one simple loop (or one batch noise call) that the compiler can
+ * vectorize. The intermediate values of a tile take only a few KB, so they
+ * stay in the L1 cache, and a buffer is reused as soon as the last node
+ * that reads it is done. Only the nodes that the output depends on are
+ * evaluated. Tiles are independent, and are spread over threads when
+ * OpenMP is enabled.
+ *
+ * Domain warping needs no special node: add the noise to the coordinate
+ * nodes, and use the sums as the inputs of another noise node.
+ */
+
+#define NOISEGRAPH_MAXNODES 64
+#define NOISEGRAPH_TILE 64
+
+enum {
+    NOISEGRAPH_X, NOISEGRAPH_Y, NOISEGRAPH_Z, // Point coordinates
+    NOISEGRAPH_CONST,                         // p0
+    NOISEGRAPH_ADD, NOISEGRAPH_SUB, NOISEGRAPH_MUL, // a+b, a-b, a*b
+    NOISEGRAPH_MIN, NOISEGRAPH_MAX,           // min(a,b), max(a,b)
+    NOISEGRAPH_SCALE,                         // a*p0 + p1
+    NOISEGRAPH_ABS,                           // |a|
+    NOISEGRAPH_RIDGE,                         // p0 - |a|
+    NOISEGRAPH_CLAMP,                         // a clamped to [p0,p1]
+    NOISEGRAPH_LERP,                          // a + c*(b-a)
+    NOISEGRAPH_NOISE3, NOISEGRAPH_SNOISE3,    // noise3(a,b,c), snoise3(a,b,c)
+    NOISEGRAPH_FBM3, NOISEGRAPH_SFBM3         // fbm3(a,b,c,...), sfbm3(...)
+};
+
+typedef struct {
+    int op;           // One of the NOISEGRAPH_ constants
+    int a, b, c;      // Input nodes, -1 if not used
+    int octaves;      // fBm parameters, for NOISEGRAPH_FBM3 and _SFBM3
+    float p0, p1;     // Constant parameters, see above
+} noisegraph_node;
+
+typedef struct {
+    int count;                              // Number of nodes in use
+    noisegraph_node node[NOISEGRAPH_MAXNODES];
+} noisegraph;
+
+/** Start a new, empty graph.
+ */
+extern void noisegraph_init( noisegraph *g );
+
+/** Add a node. These return the index of the new node, or -1.
+ */
+extern int noisegraph_coord( noisegraph *g, int axis ); // 0, 1, 2 for x, y, z
+extern int noisegraph_const( noisegraph *g, float value );
+extern int noisegraph_binary( noisegraph *g, int op, int a, int b );
+extern int noisegraph_scale( noisegraph *g, int a, float scale, float bias );
+extern int noisegraph_abs( noisegraph *g, int a );
+extern int noisegraph_ridge( noisegraph *g, int a, float offset );
+extern int noisegraph_clamp( noisegraph *g, int a, float lo, float hi );
+extern int noisegraph_lerp( noisegraph *g, int a, int b, int t );
+extern int noisegraph_noise( noisegraph *g, int op, int x, int y, int z );
+extern int noisegraph_fbm( noisegraph *g, int op, int x, int y, int z,
+                           int octaves, float lacunarity, float gain );
+
+/** Evaluate node out of the graph at n points (x[i], y[i], z[i]), and
+ * store the values in result[]. If nthreads is zero or negative, all
+ * available processors are used. Returns 0, or -1 if out is not a valid
+ * node.
+ */
+extern int noisegraph_eval( const noisegraph *g, int out, int n,
+                            const float *x, const float *y, const float *z,
+                            float *result, int nthreads );
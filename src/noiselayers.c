@@ -0,0 +1,152 @@
+// noiselayers
+//
+// Editable 2D fBm with a cache of the noise layer of each octave, for
+// interactive tweaking of the octave weights and the remap curve.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noiselayers.h" for a description. This file needs "noisegen.c"
+ * and "simplexnoise1234.c" to be linked with it.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "simplexnoise1234.h"
+#include "noisegen.h"
+#include "noiselayers.h"
+
+//---------------------------------------------------------------------
+/** Allocate the layers and set up plain fBm parameters.
+ */
+int noiselayers_init( noiselayers *nl, int width, int height,
+                      float x0, float y0, float step,
+                      int octaves, float lacunarity, float gain )
+{
+    float freq = 1.0f, amp = 1.0f;
+    int o;
+
+    nl->octaves = 0;
+    if( octaves < 1 || octaves > NOISELAYERS_MAXOCTAVES ) return -1;
+
+    nl->width = width;
+    nl->height = height;
+    nl->x0 = x0;
+    nl->y0 = y0;
+    nl->step = step;
+    nl->cx0 = x0;
+    nl->cy0 = y0;
+    nl->cstep = step;
+    nl->nthreads = 0;
+    nl->remap = 0;
+    nl->remapsize = 0;
+    nl->rmin = -1.0f;
+    nl->rmax = 1.0f;
+
+    for( o = 0; o < octaves; o++ ) {
+        nl->freq[o] = freq;
+        nl->xoff[o] = nl->yoff[o] = 0.0f;
+        nl->seed[o] = 0;
+        nl->weight[o] = amp;
+        nl->valid[o] = 0;
+        nl->layer[o] = (float *)malloc( sizeof(float) * width * height );
+        nl->octaves = o + 1;
+        if( !nl->layer[o] ) {
+            noiselayers_free( nl );
+            return -1;
+        }
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------
+/** Free the memory held by the layers.
+ */
+void noiselayers_free( noiselayers *nl )
+{
+    int o;
+
+    for( o = 0; o < nl->octaves; o++ ) {
+        free( nl->layer[o] );
+        nl->layer[o] = 0;
+        nl->valid[o] = 0;
+    }
+    nl->octaves = 0;
+}
+
+//---------------------------------------------------------------------
+
+// Look up v in the remap table, with linear interpolation
+static float remap_value( const noiselayers *nl, float v )
+{
+    float u;
+    int k;
+
+    if( nl->remapsize < 2 || nl->rmax <= nl->rmin )
+        return nl->remap[0];
+    u = ( v - nl->rmin ) / ( nl->rmax - nl->rmin ) * ( nl->remapsize - 1 );
+    if( !( u > 0.0f ) ) return nl->remap[0]; // Also catches NaN
+    if( u >= (float)( nl->remapsize - 1 ) ) return nl->remap[nl->remapsize - 1];
+    k = (int)u;
+    u -= k;
+    return nl->remap[k] + u * ( nl->remap[k + 1] - nl->remap[k] );
+}
+
+//---------------------------------------------------------------------
+/** Refresh the stale layers and recombine them into out[].
+ */
+int noiselayers_update( noiselayers *nl, float *out )
+{
+    size_t n = (size_t)nl->width * nl->height, i;
+    int o, computed = 0;
+
+    // Moving the grid changes every layer
+    if( nl->x0 != nl->cx0 || nl->y0 != nl->cy0 || nl->step != nl->cstep ) {
+        for( o = 0; o < nl->octaves; o++ ) nl->valid[o] = 0;
+        nl->cx0 = nl->x0;
+        nl->cy0 = nl->y0;
+        nl->cstep = nl->step;
+    }
+
+    for( o = 0; o < nl->octaves; o++ ) {
+        float f = nl->freq[o], sx, sy;
+
+        if( nl->valid[o] && f == nl->cfreq[o] && nl->xoff[o] == nl->cxoff[o]
+            && nl->yoff[o] == nl->cyoff[o] && nl->seed[o] == nl->cseed[o] )
+            continue;
+
+        // The seed shifts the pattern by whole cells, within one period
+        sx = nl->xoff[o] + (float)( ( nl->seed[o] * 97 ) & 0xff );
+        sy = nl->yoff[o] + (float)( ( nl->seed[o] * 61 ) & 0xff );
+        noisegen2( snoise2_batch, nl->layer[o], nl->width, nl->height,
+                   nl->x0 * f + sx, nl->y0 * f + sy, nl->step * f,
+                   nl->nthreads );
+
+        nl->cfreq[o] = f;
+        nl->cxoff[o] = nl->xoff[o];
+        nl->cyoff[o] = nl->yoff[o];
+        nl->cseed[o] = nl->seed[o];
+        nl->valid[o] = 1;
+        computed++;
+    }
+
+    // Weighted sum, one layer at a time to stream through memory
+    for( i = 0; i < n; i++ ) out[i] = 0.0f;
+    for( o = 0; o < nl->octaves; o++ ) {
+        const float *src = nl->layer[o];
+        float w = nl->weight[o];
+        if( w == 0.0f ) continue;
+        for( i = 0; i < n; i++ ) out[i] += w * src[i];
+    }
+
+    if( nl->remap && nl->remapsize > 0 )
+        for( i = 0; i < n; i++ ) out[i] = remap_value( nl, out[i] );
+
+    return computed;
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,74 @@
+// noiselayers
+//
+// Editable 2D fBm with a cache of the noise layer of each octave, for
+// interactive tweaking of the octave weights and the remap curve.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * The result over a width x height grid, with sample (i,j) at
+ * (x,y) = (x0 + i*step, y0 + j*step), is
+ *
+ *   out = remap( sum over o of weight[o] * layer[o] )
+ *
+ * where layer[o] is snoise2() over the grid scaled by freq[o] and shifted
+ * by (xoff[o], yoff[o]). A nonzero seed[o] moves the layer by a further
+ * whole number of lattice cells, which gives a different noise pattern.
+ *
+ * The layers are kept in memory between updates. The parameters above the
+ * cache state in the struct can be changed freely between calls to
+ * noiselayers_update(). A layer is computed again only if its freq, xoff,
+ * yoff or seed changed, and all of them are if x0, y0 or step changed.
+ * Changes to weight[] and to the remap curve only redo the weighted sum,
+ * which is much cheaper than evaluating the noise. The grid size and the
+ * number of layers are set by noiselayers_init() and cannot be changed.
+ *
+ * The remap curve is a table of remapsize values for inputs evenly spaced
+ * from rmin to rmax, with linear interpolation in between and clamping
+ * outside. Set remap to null to use the sum as it is.
+ */
+
+#define NOISELAYERS_MAXOCTAVES 16
+
+typedef struct {
+    float x0, y0, step;                     // Grid position and spacing
+    int nthreads;                           // Threads for noisegen2()
+    float freq[NOISELAYERS_MAXOCTAVES];     // Frequency of each layer
+    float xoff[NOISELAYERS_MAXOCTAVES];     // Offset of each layer
+    float yoff[NOISELAYERS_MAXOCTAVES];
+    int seed[NOISELAYERS_MAXOCTAVES];       // Pattern selector of each layer
+    float weight[NOISELAYERS_MAXOCTAVES];   // Weight of each layer in the sum
+    const float *remap;                     // Remap table, or null
+    int remapsize;                          // Number of entries in remap[]
+    float rmin, rmax;                       // Input range of the remap table
+    // Cache state, not to be changed by the user
+    int width, height;                      // Grid size
+    int octaves;                            // Number of layers
+    float cx0, cy0, cstep;                  // Grid of the cached layers
+    float *layer[NOISELAYERS_MAXOCTAVES];   // Noise of each layer
+    int valid[NOISELAYERS_MAXOCTAVES];      // Nonzero if layer[o] is current
+    float cfreq[NOISELAYERS_MAXOCTAVES];    // Parameters of the cached layers
+    float cxoff[NOISELAYERS_MAXOCTAVES];
+    float cyoff[NOISELAYERS_MAXOCTAVES];
+    int cseed[NOISELAYERS_MAXOCTAVES];
+} noiselayers;
+
+/** Allocate the layers, and set up the parameters of ordinary fBm:
+ * freq[o] = lacunarity^o, weight[o] = gain^o, no offsets, seeds or remap.
+ * Returns 0 on success, or -1 if out of memory or if octaves is not in
+ * the range 1..NOISELAYERS_MAXOCTAVES.
+ */
+extern int noiselayers_init( noiselayers *nl, int width, int height,
+                             float x0, float y0, float step,
+                             int octaves, float lacunarity, float gain );
+
+/** Free the memory held by the layers.
+ */
+extern void noiselayers_free( noiselayers *nl );
+
+/** Compute the layers whose parameters changed, and write the remapped
+ * weighted sum to out[j*width + i]. Returns the number of layers that
+ * had to be computed.
+ */
+extern int noiselayers_update( noiselayers *nl, float *out );
@@ -0,0 +1,104 @@
+// noiselod
+//
+// Sets of 2D fBm grids at several levels of detail, with the coarse
+// octaves shared between levels.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noiselod.h" for a description. This file needs
+ * "simplexnoise1234.c" to be linked with it.
+ *
+ * The octave frequencies and amplitudes are accumulated by repeated
+ * multiplication, in the same way as in "fbm.c", so a sum that is started
+ * at the coarse level and continued at the fine level gives exactly the
+ * same float result as sfbm2() with all the octaves at once.
+ */
+
+#include "simplexnoise1234.h"
+#include "noiselod.h"
+
+#define MAXOCTAVES 64
+
+//---------------------------------------------------------------------
+
+// Add octaves o0..o1-1 at (x,y) to sum
+static float add_octaves( float sum, float x, float y, int o0, int o1,
+                          const float *freq, const float *amp )
+{
+    int o;
+    for( o = o0; o < o1; o++ )
+        sum += amp[o] * snoise2( x * freq[o], y * freq[o] );
+    return sum;
+}
+
+//---------------------------------------------------------------------
+/** Fill a set of LOD levels of sfbm2(), coarsest first.
+ */
+void sfbm2_lodgen( float **out, int levels, int size,
+                   float x0, float y0, float step,
+                   int octaves, float lacunarity, float gain,
+                   int mode )
+{
+    float freq[MAXOCTAVES], amp[MAXOCTAVES], f = 1.0f, a = 1.0f, lstep;
+    int l, i, j, n, nc, oct, coct;
+    float *dst, *src;
+
+    if( octaves > MAXOCTAVES ) octaves = MAXOCTAVES;
+    for( l = 0; l < octaves; l++ ) {
+        freq[l] = f;
+        amp[l] = a;
+        f *= lacunarity;
+        a *= gain;
+    }
+
+    for( l = levels - 1; l >= 0; l-- ) {
+        n = NOISELOD_SIZE( size, l );
+        lstep = step * (float)( 1 << l );
+        oct = ( octaves - l > 1 ) ? octaves - l : 1;
+        dst = out[l];
+
+        if( l == levels - 1 ) { // Coarsest level, nothing to share
+            for( j = 0; j < n; j++ )
+                for( i = 0; i < n; i++ )
+                    dst[j*n + i] = add_octaves( 0.0f, x0 + i*lstep,
+                                                y0 + j*lstep, 0, oct,
+                                                freq, amp );
+            continue;
+        }
+
+        src = out[l + 1];
+        nc = NOISELOD_SIZE( size, l + 1 );
+        coct = ( octaves - l - 1 > 1 ) ? octaves - l - 1 : 1;
+        if( coct > oct ) coct = oct;
+
+        for( j = 0; j < n; j++ ) {
+            int jc = j >> 1, jodd = ( j & 1 ) || jc >= nc;
+            for( i = 0; i < n; i++ ) {
+                int ic = i >> 1, iodd = ( i & 1 ) || ic >= nc;
+                float x = x0 + i*lstep, y = y0 + j*lstep, sum;
+
+                if( !iodd && !jodd ) {
+                    // On a coarse sample: continue its sum
+                    sum = src[jc*nc + ic];
+                }
+                else if( mode == NOISELOD_UPSAMPLE && ic + iodd < nc
+                         && jc + jodd < nc ) {
+                    // Between coarse samples: interpolate the shared part
+                    sum = src[jc*nc + ic] + src[( jc + jodd )*nc + ic]
+                        + src[jc*nc + ic + iodd]
+                        + src[( jc + jodd )*nc + ic + iodd];
+                    sum *= 0.25f;
+                }
+                else {
+                    sum = add_octaves( 0.0f, x, y, 0, coct, freq, amp );
+                }
+                dst[j*n + i] = add_octaves( sum, x, y, coct, oct,
+                                            freq, amp );
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
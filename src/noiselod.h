@@ -0,0 +1,51 @@
+// noiselod
+//
+// Sets of 2D fBm grids at several levels of detail, with the coarse
+// octaves shared between levels.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * Level l is a grid of n_l x n_l samples, where n_l = (size-1)/2^l + 1,
+ * with sample (i,j) at (x0 + i*step*2^l, y0 + j*step*2^l). All levels
+ * cover the same square, and every sample of level l+1 lies on a sample
+ * of level l. Level l holds sfbm2() (see "fbm.h") with octaves - l
+ * octaves, but at least one, which suits a lacunarity of 2: each level
+ * has half the resolution and one octave less than the one before it.
+ *
+ * The levels are built from the coarsest up. Since the octaves are summed
+ * in order, a coarse sample is exactly the first few terms of the finer
+ * sums at the same point, so the samples of level l that lie on level
+ * l+1 only need their extra octaves added. The other 3/4 of the samples
+ * are either computed in full (NOISELOD_EXACT), which gives exactly
+ * the same values as calling sfbm2() for every sample, or get the shared
+ * octaves interpolated bilinearly from level l+1 (NOISELOD_UPSAMPLE).
+ * The second way evaluates almost only the extra octaves of each level,
+ * at the cost of an interpolation error. That error is only small when
+ * the shared octaves are smooth at the spacing of the coarser level, which
+ * means that the finest octave of every level must be oversampled: with
+ * 8 octaves and 5 levels, the largest errors measured over a few
+ * 513x513 regions were 0.007 for step*2^7 = 0.064 (in units of the noise
+ * lattice), 0.027 for step*2^7 = 0.128 and 0.28 for step*2^7 = 0.5.
+ * These are measurements, not bounds, and the errors add up from level
+ * to level.
+ *
+ * For all levels to cover exactly the same square, size-1 should be a
+ * multiple of 2^(levels-1).
+ */
+
+#define NOISELOD_EXACT 0
+#define NOISELOD_UPSAMPLE 1
+
+/** Size of level l for a given size of level 0.
+ */
+#define NOISELOD_SIZE(size, l) ( ( ( (size) - 1 ) >> (l) ) + 1 )
+
+/** Fill levels 0..levels-1. out[l] must have room for n_l*n_l samples,
+ * and sample (i,j) of level l is stored in out[l][j*n_l + i].
+ */
+extern void sfbm2_lodgen( float **out, int levels, int size,
+                          float x0, float y0, float step,
+                          int octaves, float lacunarity, float gain,
+                          int mode );
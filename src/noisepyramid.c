@@ -0,0 +1,321 @@
+// noisepyramid
+//
+// Hierarchical min/max pyramid over a noise volume, for skipping
+// empty space when ray marching through noise-based density.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noisepyramid.h" for a description. The analytic builder needs
+ * "fbm.c", "noise1234.c" and "simplexnoise1234.c" to be linked with it.
+ *
+ * All internal computations are made in voxel units, where voxel (i,j,k)
+ * is at (i,j,k) and a node at level l spans 8*2^l voxels along each axis.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "fbm.h"
+#include "noisepyramid.h"
+
+#define FASTFLOOR(x) ( ((int)(x)<=(x)) ? ((int)x) : (((int)x)-1) )
+
+//---------------------------------------------------------------------
+
+// Set up the level sizes and allocate the node arrays
+static int pyramid_alloc( noisepyramid *pyr,
+                          int width, int height, int depth,
+                          float x0, float y0, float z0, float step )
+{
+    int nx, ny, nz, l;
+
+    pyr->width = width;
+    pyr->height = height;
+    pyr->depth = depth;
+    pyr->x0 = x0;
+    pyr->y0 = y0;
+    pyr->z0 = z0;
+    pyr->step = step;
+
+    // Bricks span 8 voxel intervals, and there are width-1 intervals
+    nx = ( width - 1 + NOISEPYRAMID_BRICK - 1 ) / NOISEPYRAMID_BRICK;
+    ny = ( height - 1 + NOISEPYRAMID_BRICK - 1 ) / NOISEPYRAMID_BRICK;
+    nz = ( depth - 1 + NOISEPYRAMID_BRICK - 1 ) / NOISEPYRAMID_BRICK;
+    if( nx < 1 ) nx = 1;
+    if( ny < 1 ) ny = 1;
+    if( nz < 1 ) nz = 1;
+
+    for( l = 0; l < NOISEPYRAMID_MAXLEVELS; l++ ) {
+        pyr->nx[l] = nx;
+        pyr->ny[l] = ny;
+        pyr->nz[l] = nz;
+        pyr->vmin[l] = (float *)malloc( sizeof(float) * nx * ny * nz );
+        pyr->vmax[l] = (float *)malloc( sizeof(float) * nx * ny * nz );
+        pyr->levels = l + 1;
+        if( !pyr->vmin[l] || !pyr->vmax[l] ) {
+            noisepyramid_free( pyr );
+            return -1;
+        }
+        if( nx == 1 && ny == 1 && nz == 1 ) break;
+        nx = ( nx + 1 ) / 2;
+        ny = ( ny + 1 ) / 2;
+        nz = ( nz + 1 ) / 2;
+    }
+    return 0;
+}
+
+// Fill levels 1 and up by merging 2x2x2 nodes of the level below
+static void pyramid_merge( noisepyramid *pyr )
+{
+    int l, i, j, k, ci, cj, ck;
+
+    for( l = 1; l < pyr->levels; l++ ) {
+        int nx = pyr->nx[l], ny = pyr->ny[l], nz = pyr->nz[l];
+        int cnx = pyr->nx[l-1], cny = pyr->ny[l-1], cnz = pyr->nz[l-1];
+        for( k = 0; k < nz; k++ )
+        for( j = 0; j < ny; j++ )
+        for( i = 0; i < nx; i++ ) {
+            float lo = pyr->vmin[l-1][ ( 2*k * cny + 2*j ) * cnx + 2*i ];
+            float hi = pyr->vmax[l-1][ ( 2*k * cny + 2*j ) * cnx + 2*i ];
+            for( ck = 2*k; ck < 2*k + 2 && ck < cnz; ck++ )
+            for( cj = 2*j; cj < 2*j + 2 && cj < cny; cj++ )
+            for( ci = 2*i; ci < 2*i + 2 && ci < cnx; ci++ ) {
+                int c = ( ck * cny + cj ) * cnx + ci;
+                if( pyr->vmin[l-1][c] < lo ) lo = pyr->vmin[l-1][c];
+                if( pyr->vmax[l-1][c] > hi ) hi = pyr->vmax[l-1][c];
+            }
+            pyr->vmin[l][ ( k * ny + j ) * nx + i ] = lo;
+            pyr->vmax[l][ ( k * ny + j ) * nx + i ] = hi;
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+/** Build a pyramid from a sampled volume.
+ */
+int noisepyramid_from_volume( noisepyramid *pyr, const float *vol,
+                              int width, int height, int depth,
+                              float x0, float y0, float z0, float step )
+{
+    int bi, bj, bk, i, j, k;
+
+    if( pyramid_alloc( pyr, width, height, depth, x0, y0, z0, step ) )
+        return -1;
+
+    for( bk = 0; bk < pyr->nz[0]; bk++ )
+    for( bj = 0; bj < pyr->ny[0]; bj++ )
+    for( bi = 0; bi < pyr->nx[0]; bi++ ) {
+        // Voxels of this brick, including the shared ones on its far faces
+        int i0 = bi * NOISEPYRAMID_BRICK, i1 = i0 + NOISEPYRAMID_BRICK;
+        int j0 = bj * NOISEPYRAMID_BRICK, j1 = j0 + NOISEPYRAMID_BRICK;
+        int k0 = bk * NOISEPYRAMID_BRICK, k1 = k0 + NOISEPYRAMID_BRICK;
+        float lo, hi;
+        if( i1 > width - 1 ) i1 = width - 1;
+        if( j1 > height - 1 ) j1 = height - 1;
+        if( k1 > depth - 1 ) k1 = depth - 1;
+
+        lo = hi = vol[ ( (size_t)k0 * height + j0 ) * width + i0 ];
+        for( k = k0; k <= k1; k++ )
+        for( j = j0; j <= j1; j++ )
+        for( i = i0; i <= i1; i++ ) {
+            float v = vol[ ( (size_t)k * height + j ) * width + i ];
+            if( v < lo ) lo = v;
+            if( v > hi ) hi = v;
+        }
+        pyr->vmin[0][ ( bk * pyr->ny[0] + bj ) * pyr->nx[0] + bi ] = lo;
+        pyr->vmax[0][ ( bk * pyr->ny[0] + bj ) * pyr->nx[0] + bi ] = hi;
+    }
+
+    pyramid_merge( pyr );
+    return 0;
+}
+
+//---------------------------------------------------------------------
+/** Build a pyramid from the analytic bounds of sfbm3().
+ */
+int noisepyramid_from_sfbm3( noisepyramid *pyr,
+                             int width, int height, int depth,
+                             float x0, float y0, float z0, float step,
+                             int octaves, float lacunarity, float gain )
+{
+    int bi, bj, bk;
+    float size = NOISEPYRAMID_BRICK * step;
+
+    if( pyramid_alloc( pyr, width, height, depth, x0, y0, z0, step ) )
+        return -1;
+
+    for( bk = 0; bk < pyr->nz[0]; bk++ )
+    for( bj = 0; bj < pyr->ny[0]; bj++ )
+    for( bi = 0; bi < pyr->nx[0]; bi++ ) {
+        float bx = x0 + bi * size, by = y0 + bj * size, bz = z0 + bk * size;
+        sfbm3_bounds( bx, by, bz, bx + size, by + size, bz + size,
+                      octaves, lacunarity, gain,
+                      &pyr->vmin[0][ ( bk * pyr->ny[0] + bj ) * pyr->nx[0] + bi ],
+                      &pyr->vmax[0][ ( bk * pyr->ny[0] + bj ) * pyr->nx[0] + bi ] );
+    }
+
+    pyramid_merge( pyr );
+    return 0;
+}
+
+//---------------------------------------------------------------------
+/** Free the node arrays of a pyramid.
+ */
+void noisepyramid_free( noisepyramid *pyr )
+{
+    int l;
+    for( l = 0; l < pyr->levels; l++ ) {
+        free( pyr->vmin[l] );
+        free( pyr->vmax[l] );
+        pyr->vmin[l] = pyr->vmax[l] = 0;
+    }
+    pyr->levels = 0;
+}
+
+//---------------------------------------------------------------------
+
+// Merge the ranges of all nodes below node (i,j,k) at level l that
+// overlap the box [lo,hi] (in voxel units) into *vmin, *vmax.
+static void range_node( const noisepyramid *pyr, int l, int i, int j, int k,
+                        const float *lo, const float *hi,
+                        float *vmin, float *vmax )
+{
+    float size = (float)( NOISEPYRAMID_BRICK << l );
+    float nlo[3], nhi[3];
+    int n, ci, cj, ck;
+
+    if( i >= pyr->nx[l] || j >= pyr->ny[l] || k >= pyr->nz[l] ) return;
+    nlo[0] = i * size; nhi[0] = nlo[0] + size;
+    nlo[1] = j * size; nhi[1] = nlo[1] + size;
+    nlo[2] = k * size; nhi[2] = nlo[2] + size;
+    if( hi[0] < nlo[0] || lo[0] > nhi[0] || hi[1] < nlo[1] || lo[1] > nhi[1]
+        || hi[2] < nlo[2] || lo[2] > nhi[2] ) return; // No overlap
+
+    if( l == 0 || ( lo[0] <= nlo[0] && hi[0] >= nhi[0] && lo[1] <= nlo[1]
+                    && hi[1] >= nhi[1] && lo[2] <= nlo[2] && hi[2] >= nhi[2] ) ) {
+        n = ( k * pyr->ny[l] + j ) * pyr->nx[l] + i;
+        if( pyr->vmin[l][n] < *vmin ) *vmin = pyr->vmin[l][n];
+        if( pyr->vmax[l][n] > *vmax ) *vmax = pyr->vmax[l][n];
+        return;
+    }
+
+    for( ck = 2*k; ck < 2*k + 2; ck++ )
+    for( cj = 2*j; cj < 2*j + 2; cj++ )
+    for( ci = 2*i; ci < 2*i + 2; ci++ )
+        range_node( pyr, l - 1, ci, cj, ck, lo, hi, vmin, vmax );
+}
+
+/** Bounds of the values within a box. If the box does not overlap
+ * the volume, *vmin is returned greater than *vmax.
+ */
+void noisepyramid_range( const noisepyramid *pyr,
+                         float x0, float y0, float z0,
+                         float x1, float y1, float z1,
+                         float *vmin, float *vmax )
+{
+    float lo[3], hi[3], inv = 1.0f / pyr->step;
+
+    lo[0] = ( x0 - pyr->x0 ) * inv; hi[0] = ( x1 - pyr->x0 ) * inv;
+    lo[1] = ( y0 - pyr->y0 ) * inv; hi[1] = ( y1 - pyr->y0 ) * inv;
+    lo[2] = ( z0 - pyr->z0 ) * inv; hi[2] = ( z1 - pyr->z0 ) * inv;
+
+    *vmin = 1.0e30f;
+    *vmax = -1.0e30f;
+    range_node( pyr, pyr->levels - 1, 0, 0, 0, lo, hi, vmin, vmax );
+}
+
+//---------------------------------------------------------------------
+
+// Clip the ray p + t*d to the slab [lo,hi] along one axis
+static int clip_slab( float p, float d, float lo, float hi,
+                      float *t0, float *t1 )
+{
+    float ta, tb;
+    if( d == 0.0f ) return ( p >= lo && p <= hi );
+    ta = ( lo - p ) / d;
+    tb = ( hi - p ) / d;
+    if( ta > tb ) { float tmp = ta; ta = tb; tb = tmp; }
+    if( ta > *t0 ) *t0 = ta;
+    if( tb < *t1 ) *t1 = tb;
+    return *t0 <= *t1;
+}
+
+/** Empty-space skipping along a ray.
+ */
+float noisepyramid_skip( const noisepyramid *pyr,
+                         float ox, float oy, float oz,
+                         float dx, float dy, float dz,
+                         float t, float tmax, float iso )
+{
+    float inv = 1.0f / pyr->step;
+    float p[3], d[3], tend = tmax, tlook, eps, dmax;
+    int a;
+
+    // Work in voxel units. The ray parameter t is not affected by this.
+    p[0] = ( ox - pyr->x0 ) * inv; d[0] = dx * inv;
+    p[1] = ( oy - pyr->y0 ) * inv; d[1] = dy * inv;
+    p[2] = ( oz - pyr->z0 ) * inv; d[2] = dz * inv;
+
+    // Only the part of the ray inside the volume needs to be walked
+    if( !clip_slab( p[0], d[0], 0.0f, (float)( pyr->width - 1 ), &t, &tend )
+        || !clip_slab( p[1], d[1], 0.0f, (float)( pyr->height - 1 ), &t, &tend )
+        || !clip_slab( p[2], d[2], 0.0f, (float)( pyr->depth - 1 ), &t, &tend ) )
+        return tmax;
+
+    // Look up the next node a small fraction of a voxel past each node
+    // boundary, but report the boundary itself as the entry point
+    dmax = 0.0f;
+    for( a = 0; a < 3; a++ )
+        if( d[a] > dmax ) dmax = d[a]; else if( -d[a] > dmax ) dmax = -d[a];
+    eps = ( dmax > 0.0f ) ? 1.0e-3f / dmax : 0.0f;
+
+    tlook = t;
+    while( tlook <= tend ) {
+        int b[3], l, empty = -1;
+        float texit;
+
+        // Brick containing the look-up point
+        for( a = 0; a < 3; a++ ) {
+            float v = ( p[a] + tlook * d[a] ) * ( 1.0f / NOISEPYRAMID_BRICK );
+            b[a] = FASTFLOOR( v );
+            if( b[a] < 0 ) b[a] = 0;
+        }
+        if( b[0] >= pyr->nx[0] ) b[0] = pyr->nx[0] - 1;
+        if( b[1] >= pyr->ny[0] ) b[1] = pyr->ny[0] - 1;
+        if( b[2] >= pyr->nz[0] ) b[2] = pyr->nz[0] - 1;
+
+        // Find the largest node around the point that is entirely below iso
+        for( l = pyr->levels - 1; l >= 0; l-- ) {
+            int n = ( ( b[2] >> l ) * pyr->ny[l] + ( b[1] >> l ) ) * pyr->nx[l]
+                    + ( b[0] >> l );
+            if( pyr->vmax[l][n] < iso ) { empty = l; break; }
+        }
+        if( empty < 0 ) return t; // This brick may reach iso
+
+        // Skip to where the ray leaves the empty node
+        texit = tend;
+        for( a = 0; a < 3; a++ ) {
+            float size = (float)( NOISEPYRAMID_BRICK << empty );
+            float nlo = ( b[a] >> empty ) * size;
+            if( d[a] > 0.0f ) {
+                float te = ( nlo + size - p[a] ) / d[a];
+                if( te < texit ) texit = te;
+            } else if( d[a] < 0.0f ) {
+                float te = ( nlo - p[a] ) / d[a];
+                if( te < texit ) texit = te;
+            }
+        }
+        if( texit >= tend ) break;
+        if( texit > t ) t = texit;
+        texit = ( texit > tlook ) ? texit + eps : tlook + eps;
+        // Far from the origin, eps can be lost to rounding, and the look-up
+        // point would fall back into the same node. Always move on by at
+        // least one representable value.
+        tlook = ( texit > tlook ) ? texit : nextafterf( tlook, HUGE_VALF );
+    }
+    return tmax;
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,72 @@
+// noisepyramid
+//
+// Hierarchical min/max pyramid over a noise volume, for skipping
+// empty space when ray marching through noise-based density.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * A volume of width x height x depth voxels, where voxel (i,j,k) is at
+ * (x0 + i*step, y0 + j*step, z0 + k*step), is divided into bricks of
+ * 8x8x8 voxels. Level 0 of the pyramid holds the minimum and maximum
+ * value within each brick, and each following level merges 2x2x2 nodes
+ * of the level below, up to a single root node.
+ *
+ * The range of a brick covers the whole box between its corner voxels,
+ * including the voxels it shares with its neighbours, so it is valid
+ * for any trilinear interpolation of the samples within the brick.
+ */
+
+#define NOISEPYRAMID_BRICK 8
+#define NOISEPYRAMID_MAXLEVELS 24
+
+typedef struct {
+    int levels;                          // Number of levels in use
+    int nx[NOISEPYRAMID_MAXLEVELS];      // Nodes along x at each level
+    int ny[NOISEPYRAMID_MAXLEVELS];      // Nodes along y at each level
+    int nz[NOISEPYRAMID_MAXLEVELS];      // Nodes along z at each level
+    float *vmin[NOISEPYRAMID_MAXLEVELS]; // Node minima, x varying fastest
+    float *vmax[NOISEPYRAMID_MAXLEVELS]; // Node maxima
+    int width, height, depth;            // Volume size in voxels
+    float x0, y0, z0, step;              // Position of voxel (0,0,0), spacing
+} noisepyramid;
+
+/** Build a pyramid from sampled data, stored with x varying fastest:
+ * vol[(k*height + j)*width + i]. Returns 0 on success, -1 if out of memory.
+ */
+extern int noisepyramid_from_volume( noisepyramid *pyr, const float *vol,
+                                     int width, int height, int depth,
+                                     float x0, float y0, float z0,
+                                     float step );
+
+/** Build a pyramid from the conservative analytic bounds of sfbm3() (see
+ * "fbm.h"), without evaluating the noise. Use octaves = 1 for plain
+ * snoise3(). Returns 0 on success, -1 if out of memory.
+ */
+extern int noisepyramid_from_sfbm3( noisepyramid *pyr,
+                                    int width, int height, int depth,
+                                    float x0, float y0, float z0, float step,
+                                    int octaves, float lacunarity,
+                                    float gain );
+
+/** Free the memory held by a pyramid.
+ */
+extern void noisepyramid_free( noisepyramid *pyr );
+
+/** Bounds of the values within the box [x0,x1]x[y0,y1]x[z0,z1], in the
+ * same coordinates as the voxel positions. The result is conservative.
+ */
+extern void noisepyramid_range( const noisepyramid *pyr,
+                                float x0, float y0, float z0,
+                                float x1, float y1, float z1,
+                                float *vmin, float *vmax );
+
+/** Empty-space skipping along the ray o + t*d. Starting from t, returns
+ * the first parameter value at which the ray enters a brick that may
+ * contain values of at least iso, or tmax if there is none before tmax.
+ */
+extern float noisepyramid_skip( const noisepyramid *pyr,
+                                float ox, float oy, float oz,
+                                float dx, float dy, float dz,
+                                float t, float tmax, float iso );
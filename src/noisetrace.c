@@ -0,0 +1,177 @@
+// noisetrace
+//
+// Sphere tracing of implicit surfaces defined by fractal simplex noise.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * See "noisetrace.h" for a description. This file needs "fbm.c" and the
+ * noise files it depends on to be linked with it.
+ */
+
+#include <math.h>
+
+#include "fbm.h"
+#include "noisetrace.h"
+
+#define NEWTON_STEPS 4
+#define PACKET_SIZE 64 // Rays traced in lockstep by sdfbm3_trace_packet()
+
+//---------------------------------------------------------------------
+/** Upper bound on the gradient magnitude of sdfbm3().
+ */
+float sdfbm3_lipschitz( int octaves, float lacunarity, float gain )
+{
+    float sum = 0.0f, freq = 1.0f, amp = 1.0f;
+    int o;
+
+    for( o = 0; o < octaves; o++ ) {
+        sum += fabsf( amp * freq );
+        freq *= lacunarity;
+        amp *= gain;
+    }
+    return NOISETRACE_MAXGRAD * sum;
+}
+
+//---------------------------------------------------------------------
+
+// Polish a hit at t, where the surface is closer than NOISETRACE_EPS,
+// with a few Newton steps along the ray. Steps that would move farther
+// than a few times the tolerance are rejected, since they mean the ray
+// only grazes the surface and the tangent is a poor guide.
+static float trace_refine( float ox, float oy, float oz,
+                           float dx, float dy, float dz, float len,
+                           float t, float tmin,
+                           int octaves, float lacunarity, float gain,
+                           float iso )
+{
+    float v, gx, gy, gz, slope, dt;
+    int k;
+
+    for( k = 0; k < NEWTON_STEPS; k++ ) {
+        v = sdfbm3( ox + t*dx, oy + t*dy, oz + t*dz,
+                    octaves, lacunarity, gain, &gx, &gy, &gz ) - iso;
+        slope = gx*dx + gy*dy + gz*dz; // Derivative along the ray
+        if( slope == 0.0f ) break;
+        dt = -v / slope;
+        if( fabsf( dt ) * len > 4.0f * NOISETRACE_EPS || t + dt < tmin ) break;
+        t += dt;
+    }
+    return t;
+}
+
+//---------------------------------------------------------------------
+/** Sphere trace a single ray.
+ */
+int sdfbm3_trace( float ox, float oy, float oz,
+                  float dx, float dy, float dz,
+                  float tmin, float tmax,
+                  int octaves, float lacunarity, float gain,
+                  float iso, float *thit )
+{
+    float len = sqrtf( dx*dx + dy*dy + dz*dz );
+    float rlip, t = tmin, dist;
+    int k;
+
+    if( len == 0.0f ) return 0;
+    rlip = 1.0f / sdfbm3_lipschitz( octaves, lacunarity, gain );
+
+    for( k = 0; k < NOISETRACE_MAXSTEPS && t <= tmax; k++ ) {
+        // A safe distance to step, from the distance to iso and the
+        // largest possible slope of the noise
+        dist = fabsf( sdfbm3( ox + t*dx, oy + t*dy, oz + t*dz,
+                              octaves, lacunarity, gain, 0, 0, 0 ) - iso ) * rlip;
+        if( dist < NOISETRACE_EPS ) {
+            t = trace_refine( ox, oy, oz, dx, dy, dz, len, t, tmin,
+                              octaves, lacunarity, gain, iso );
+            if( t > tmax ) break;
+            *thit = t;
+            return 1;
+        }
+        t += dist / len;
+    }
+    return 0;
+}
+
+//---------------------------------------------------------------------
+/** Sphere trace a packet of rays. All active rays take one step per
+ * pass over the packet. In each pass, the sample points of the rays that
+ * are still marching are gathered into arrays, and the noise is evaluated
+ * for all of them with sdfbm3_batch(), which has no branches in its inner
+ * loop and skips the derivatives. The rays are processed in groups of
+ * PACKET_SIZE, so that the scratch arrays are local. hit[] holds -1 for
+ * rays that are still marching.
+ */
+void sdfbm3_trace_packet( int n,
+                          const float *ox, const float *oy, const float *oz,
+                          const float *dx, const float *dy, const float *dz,
+                          float tmin, float tmax,
+                          int octaves, float lacunarity, float gain,
+                          float iso, float *thit, int *hit )
+{
+    float rlip = 1.0f / sdfbm3_lipschitz( octaves, lacunarity, gain );
+    float len[PACKET_SIZE], px[PACKET_SIZE], py[PACKET_SIZE], pz[PACKET_SIZE];
+    float v[PACKET_SIZE];
+    int ray[PACKET_SIZE]; // Index of the ray of each gathered sample
+    int i, i0, m, k, a, active;
+
+    for( i0 = 0; i0 < n; i0 += PACKET_SIZE ) {
+        m = ( n - i0 < PACKET_SIZE ) ? n - i0 : PACKET_SIZE;
+        for( i = i0; i < i0 + m; i++ ) {
+            len[i - i0] = sqrtf( dx[i]*dx[i] + dy[i]*dy[i] + dz[i]*dz[i] );
+            if( len[i - i0] == 0.0f ) { // No direction, no hit
+                hit[i] = 0;
+                thit[i] = tmax;
+            } else {
+                hit[i] = -1;
+                thit[i] = tmin;
+            }
+        }
+
+        for( k = 0; k < NOISETRACE_MAXSTEPS; k++ ) {
+            // Gather the sample points of the active rays
+            active = 0;
+            for( i = i0; i < i0 + m; i++ ) {
+                float t = thit[i];
+                if( hit[i] >= 0 ) continue;
+                px[active] = ox[i] + t*dx[i];
+                py[active] = oy[i] + t*dy[i];
+                pz[active] = oz[i] + t*dz[i];
+                ray[active++] = i;
+            }
+            if( active == 0 ) break;
+
+            sdfbm3_batch( active, px, py, pz, octaves, lacunarity, gain, v );
+
+            for( a = 0; a < active; a++ ) {
+                float t = thit[ray[a]], dist = fabsf( v[a] - iso ) * rlip;
+                i = ray[a];
+                if( dist < NOISETRACE_EPS ) {
+                    t = trace_refine( ox[i], oy[i], oz[i], dx[i], dy[i], dz[i],
+                                      len[i - i0], t, tmin,
+                                      octaves, lacunarity, gain, iso );
+                    hit[i] = ( t <= tmax );
+                    thit[i] = hit[i] ? t : tmax;
+                    continue;
+                }
+                t += dist / len[i - i0];
+                if( t > tmax ) {
+                    hit[i] = 0;
+                    thit[i] = tmax;
+                    continue;
+                }
+                thit[i] = t;
+            }
+        }
+
+        for( i = i0; i < i0 + m; i++ ) { // Rays that ran out of steps
+            if( hit[i] < 0 ) {
+                hit[i] = 0;
+                thit[i] = tmax;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
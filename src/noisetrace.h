@@ -0,0 +1,67 @@
+// noisetrace
+//
+// Sphere tracing of implicit surfaces defined by fractal simplex noise.
+//
+// This code is placed in the public domain, like the rest of this
+// collection. Please feel free to use it for whatever you want.
+
+/*
+ * The surface is the level set sdfbm3(p) = iso (see "fbm.h"), and rays
+ * are o + t*d. The gradient of one octave of sdnoise3() never exceeds
+ * NOISETRACE_MAXGRAD, so the gradient of the fractal sum is bounded by
+ * the sum of that constant times amplitude times frequency over all
+ * octaves. A point where the sum differs from iso by v is therefore at
+ * least v / L away from the surface, and the ray can safely step that
+ * far. Near the surface, the hit is refined with Newton steps along the
+ * ray using the analytic derivative.
+ *
+ * The falloff kernel of sdnoise3() gives a provable bound on the gradient
+ * of 72*4*sqrt(2)*27/343 = 32.06, which is the default. The four corners
+ * never reach their peak slope at once, though, and the largest gradient
+ * seen in practice is close to 6.52. Compiling "noisetrace.c" with
+ * -DNOISETRACE_MAXGRAD=NOISETRACE_GRAD_FAST takes about four times longer
+ * steps, but relies on that empirical value and may step through thin
+ * features of the surface in rare cases.
+ */
+
+#define NOISETRACE_MAXSTEPS 2048 // Give up after this many steps
+#define NOISETRACE_EPS 1.0e-4f   // Distance to the surface counted as a hit
+
+#define NOISETRACE_GRAD_SAFE 32.1f // Provable gradient bound of sdnoise3()
+#define NOISETRACE_GRAD_FAST 7.0f  // Empirical maximum 6.52, plus a margin
+
+#ifndef NOISETRACE_MAXGRAD
+#define NOISETRACE_MAXGRAD NOISETRACE_GRAD_SAFE
+#endif
+
+/** Lipschitz constant of sdfbm3() with the given parameters: the largest
+ * gradient of one octave, NOISETRACE_MAXGRAD, times the sum of amplitude
+ * times frequency over all octaves. With the default constant, this is
+ * an upper bound on the magnitude of the gradient.
+ */
+extern float sdfbm3_lipschitz( int octaves, float lacunarity, float gain );
+
+/** Trace one ray from t = tmin to t = tmax. Returns 1 and stores the ray
+ * parameter of the first surface hit in *thit, or returns 0 if there is
+ * no hit before tmax. The direction d does not need to be normalized.
+ */
+extern int sdfbm3_trace( float ox, float oy, float oz,
+                         float dx, float dy, float dz,
+                         float tmin, float tmax,
+                         int octaves, float lacunarity, float gain,
+                         float iso, float *thit );
+
+/** Trace a packet of n rays in lockstep, with the ray data in separate
+ * arrays for each coordinate. hit[i] is set to 1 or 0 as returned by
+ * sdfbm3_trace() for ray i, and thit[i] to the hit parameter, or to
+ * tmax if there is no hit. The noise for all active rays is evaluated
+ * together with sdfbm3_batch(), which makes this about twice as fast as
+ * tracing the rays one at a time.
+ */
+extern void sdfbm3_trace_packet( int n,
+                                 const float *ox, const float *oy,
+                                 const float *oz, const float *dx,
+                                 const float *dy, const float *dz,
+                                 float tmin, float tmax,
+                                 int octaves, float lacunarity, float gain,
+                                 float iso, float *thit, int *hit );
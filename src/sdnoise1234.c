@@ -29,6 +29,9 @@
  * 2012-01-12: Slight update to compile with MSVC (declarations moved).
  */
 
+#include <math.h>
+#include <stddef.h>
+
 #include "sdnoise1234.h" /* We strictly don't need this, but play nice. */
 
 #define FASTFLOOR(x) ( ((int)(x)<=(x)) ? ((int)x) : (((int)x)-1) )
@@ -712,3 +715,689 @@ float sdnoise4( float x, float y, float z, float w,
 
     return noise;
 }
+
+/* --------------------------------------------------------------------- */
+
+/** Vector-valued 3D simplex noise with derivatives: three channels from
+ * one traversal of the simplex grid. The skewing, the corner ordering,
+ * the hashes and the falloff weights are shared between the channels.
+ * Channel 0 is sdnoise3(), and channel c > 0 takes the gradient of each
+ * corner from perm[h+c] instead of its hash h, which gives more
+ * independent noise fields. Channels first to first+2 are computed.
+ */
+static void sdnoise3_channels( float x, float y, float z, int first,
+                               float *n, float *d )
+{
+    float xc[4], yc[4], zc[4], tc[4];
+    int hc[4];
+    int c, m;
+
+    float s = (x+y+z)*F3;
+    float xs = x+s;
+    float ys = y+s;
+    float zs = z+s;
+    int ii, i = FASTFLOOR(xs);
+    int jj, j = FASTFLOOR(ys);
+    int kk, k = FASTFLOOR(zs);
+
+    float t = (float)(i+j+k)*G3;
+    float X0 = i-t;
+    float Y0 = j-t;
+    float Z0 = k-t;
+    float x0 = x-X0;
+    float y0 = y-Y0;
+    float z0 = z-Z0;
+
+    int i1, j1, k1;
+    int i2, j2, k2;
+
+    if(x0>=y0) {
+      if(y0>=z0)
+        { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } /* X Y Z order */
+        else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } /* X Z Y order */
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } /* Z X Y order */
+      }
+    else { // x0<y0
+      if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } /* Z Y X order */
+      else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } /* Y Z X order */
+      else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } /* Y X Z order */
+    }
+
+    xc[0] = x0;
+    yc[0] = y0;
+    zc[0] = z0;
+    xc[1] = x0 - i1 + G3;
+    yc[1] = y0 - j1 + G3;
+    zc[1] = z0 - k1 + G3;
+    xc[2] = x0 - i2 + 2.0f * G3;
+    yc[2] = y0 - j2 + 2.0f * G3;
+    zc[2] = z0 - k2 + 2.0f * G3;
+    xc[3] = x0 - 1.0f + 3.0f * G3;
+    yc[3] = y0 - 1.0f + 3.0f * G3;
+    zc[3] = z0 - 1.0f + 3.0f * G3;
+
+    ii = i & 0xff;
+    jj = j & 0xff;
+    kk = k & 0xff;
+    hc[0] = perm[ii + perm[jj + perm[kk]]];
+    hc[1] = perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+    hc[2] = perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+    hc[3] = perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+
+    for( m = 0; m < 4; m++ ) {
+      tc[m] = 0.5f - xc[m]*xc[m] - yc[m]*yc[m] - zc[m]*zc[m];
+      if( tc[m] < 0.0f ) tc[m] = 0.0f;
+    }
+
+    /* The sums are formed in the same order as in sdnoise3(), so that
+     * channel 0 and its derivatives are exactly the same as from there */
+    for( c = 0; c < 3; c++ ) {
+      float sum = 0.0f, dx = 0.0f, dy = 0.0f, dz = 0.0f;
+      float gsx = 0.0f, gsy = 0.0f, gsz = 0.0f;
+      for( m = 0; m < 4; m++ ) {
+        float gx, gy, gz, t2, t4, gdot, temp;
+        if( tc[m] == 0.0f ) continue;
+        grad3( ( first + c ) ? perm[hc[m] + first + c] : hc[m],
+               &gx, &gy, &gz );
+        t2 = tc[m] * tc[m];
+        t4 = t2 * t2;
+        gdot = gx * xc[m] + gy * yc[m] + gz * zc[m];
+        sum += t4 * gdot;
+        temp = t2 * tc[m] * gdot;
+        dx += temp * xc[m];
+        dy += temp * yc[m];
+        dz += temp * zc[m];
+        gsx += t4 * gx;
+        gsy += t4 * gy;
+        gsz += t4 * gz;
+      }
+      n[c] = 72.0f * sum;
+      if( d ) {
+        d[3*c] = 72.0f * ( dx * -8.0f + gsx );
+        d[3*c + 1] = 72.0f * ( dy * -8.0f + gsy );
+        d[3*c + 2] = 72.0f * ( dz * -8.0f + gsz );
+      }
+    }
+}
+
+/** Vector-valued 3D simplex noise with derivatives, channels 0 to 2.
+ */
+void sdnoise3_vec3( float x, float y, float z, float *n, float *d )
+{
+    sdnoise3_channels( x, y, z, 0, n, d );
+}
+
+/** Vector-valued 3D simplex noise with derivatives, over arrays of points.
+ */
+void sdnoise3_vec3_batch( int n, const float *x, const float *y,
+                          const float *z, float *vx, float *vy, float *vz,
+                          float *jacobian )
+{
+    float v[3];
+    int i;
+
+    for( i = 0; i < n; i++ ) {
+      sdnoise3_vec3( x[i], y[i], z[i], v, jacobian ? jacobian + 9*i : 0 );
+      vx[i] = v[0];
+      vy[i] = v[1];
+      vz[i] = v[2];
+    }
+}
+
+/** Domain warped 3D simplex noise with derivatives. The warp uses
+ * channels 1 to 3, since channel 0 is the warped field itself.
+ */
+float sdnoise3_warp( float x, float y, float z, float k,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    float w[3], J[9], gx, gy, gz, noise;
+
+    sdnoise3_channels( x, y, z, 1, w, J );
+    noise = sdnoise3( x + k*w[0], y + k*w[1], z + k*w[2], &gx, &gy, &gz );
+
+    /* Chain rule: the gradient of n(p + k*w(p)) is (I + k*J)^T grad n,
+     * where J[3*c + a] is the derivative of warp channel c along axis a */
+    if( ( dnoise_dx ) && ( dnoise_dy ) && ( dnoise_dz ))
+      {
+        *dnoise_dx = gx + k * ( J[0] * gx + J[3] * gy + J[6] * gz );
+        *dnoise_dy = gy + k * ( J[1] * gx + J[4] * gy + J[7] * gz );
+        *dnoise_dz = gz + k * ( J[2] * gx + J[5] * gy + J[8] * gz );
+      }
+    return noise;
+}
+
+/** Domain warped 3D simplex noise with derivatives, over arrays of points.
+ */
+void sdnoise3_warp_batch( int n, const float *x, const float *y,
+                          const float *z, float k, float *result,
+                          float *dnoise_dx, float *dnoise_dy,
+                          float *dnoise_dz )
+{
+    int i;
+
+    if( dnoise_dx && dnoise_dy && dnoise_dz )
+      for( i = 0; i < n; i++ )
+        result[i] = sdnoise3_warp( x[i], y[i], z[i], k,
+                                   dnoise_dx + i, dnoise_dy + i, dnoise_dz + i );
+    else
+      for( i = 0; i < n; i++ )
+        result[i] = sdnoise3_warp( x[i], y[i], z[i], k, 0, 0, 0 );
+}
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * 3D simplex noise over arrays of points. When only the values are
+ * needed, the loop over the points has no branches: the floor and the
+ * choice of simplex are done with comparisons used as integers, and a
+ * corner that is out of range gets t = 0 instead of being skipped. The
+ * arithmetic is otherwise the same as in sdnoise3(), so the values are
+ * the same, and the compiler is free to vectorize the loop. If the
+ * derivative pointers are not null, sdnoise3() is called for each point.
+ */
+void sdnoise3_batch( int n, const float *x, const float *y, const float *z,
+                     float *result,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    int hperm[512]; /* perm[] widened to int, which vector loads can gather */
+    int m;
+
+    if( dnoise_dx && dnoise_dy && dnoise_dz ) {
+      for( m = 0; m < n; m++ )
+        result[m] = sdnoise3( x[m], y[m], z[m],
+                              dnoise_dx + m, dnoise_dy + m, dnoise_dz + m );
+      return;
+    }
+
+    for( m = 0; m < 512; m++ ) hperm[m] = perm[m];
+
+    for( m = 0; m < n; m++ ) {
+      float s = (x[m]+y[m]+z[m])*F3;
+      float xs = x[m]+s;
+      float ys = y[m]+s;
+      float zs = z[m]+s;
+      int i = (int)xs, j = (int)ys, k = (int)zs;
+      float t, x0, y0, z0, x1, y1, z1, x2, y2, z2, x3, y3, z3;
+      float t0, t1, t2, t3, gx, gy, gz, n0, n1, n2, n3;
+      int i1, j1, k1, i2, j2, k2, ii, jj, kk;
+
+      i -= ( xs < (float)i ); /* FASTFLOOR() without a branch */
+      j -= ( ys < (float)j );
+      k -= ( zs < (float)k );
+      t = (float)(i+j+k)*G3;
+      x0 = x[m]-(i-t);
+      y0 = y[m]-(j-t);
+      z0 = z[m]-(k-t);
+
+      /* The same simplex as chosen by the branches in sdnoise3() */
+      i1 = ( x0 >= y0 ) & ( x0 >= z0 );
+      j1 = ( y0 > x0 ) & ( y0 >= z0 );
+      k1 = ( z0 > x0 ) & ( z0 > y0 );
+      i2 = ( x0 >= y0 ) | ( x0 >= z0 );
+      j2 = ( y0 > x0 ) | ( y0 >= z0 );
+      k2 = ( z0 > x0 ) | ( z0 > y0 );
+
+      x1 = x0 - i1 + G3;
+      y1 = y0 - j1 + G3;
+      z1 = z0 - k1 + G3;
+      x2 = x0 - i2 + 2.0f * G3;
+      y2 = y0 - j2 + 2.0f * G3;
+      z2 = z0 - k2 + 2.0f * G3;
+      x3 = x0 - 1.0f + 3.0f * G3;
+      y3 = y0 - 1.0f + 3.0f * G3;
+      z3 = z0 - 1.0f + 3.0f * G3;
+
+      ii = i & 0xff;
+      jj = j & 0xff;
+      kk = k & 0xff;
+
+      t0 = 0.5f - x0*x0 - y0*y0 - z0*z0;
+      t1 = 0.5f - x1*x1 - y1*y1 - z1*z1;
+      t2 = 0.5f - x2*x2 - y2*y2 - z2*z2;
+      t3 = 0.5f - x3*x3 - y3*y3 - z3*z3;
+      t0 = 0.5f * ( t0 + fabsf( t0 ) ); /* max( t, 0 ) without a branch */
+      t1 = 0.5f * ( t1 + fabsf( t1 ) );
+      t2 = 0.5f * ( t2 + fabsf( t2 ) );
+      t3 = 0.5f * ( t3 + fabsf( t3 ) );
+      t0 *= t0; t0 *= t0;
+      t1 *= t1; t1 *= t1;
+      t2 *= t2; t2 *= t2;
+      t3 *= t3; t3 *= t3;
+
+      grad3( hperm[ii + hperm[jj + hperm[kk]]], &gx, &gy, &gz );
+      n0 = t0 * ( gx * x0 + gy * y0 + gz * z0 );
+      grad3( hperm[ii + i1 + hperm[jj + j1 + hperm[kk + k1]]], &gx, &gy, &gz );
+      n1 = t1 * ( gx * x1 + gy * y1 + gz * z1 );
+      grad3( hperm[ii + i2 + hperm[jj + j2 + hperm[kk + k2]]], &gx, &gy, &gz );
+      n2 = t2 * ( gx * x2 + gy * y2 + gz * z2 );
+      grad3( hperm[ii + 1 + hperm[jj + 1 + hperm[kk + 1]]], &gx, &gy, &gz );
+      n3 = t3 * ( gx * x3 + gy * y3 + gz * z3 );
+
+      result[m] = 72.0f * (n0 + n1 + n2 + n3);
+    }
+}
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * 3D simplex noise over strided arrays, for interleaved vertex buffers.
+ * Element i of an array is i*stride bytes after its first element, and
+ * STRIDED_IN() keeps the const of the input arrays.
+ */
+#define STRIDED(p, i, stride) \
+  (*(float *)((char *)(p) + (size_t)(i) * (stride)))
+#define STRIDED_IN(p, i, stride) \
+  (*(const float *)((const char *)(p) + (size_t)(i) * (stride)))
+
+void sdnoise3_batch_strided( int n, const float *x, const float *y,
+                             const float *z, int stride,
+                             float *result, int rstride,
+                             float *dnoise_dx, float *dnoise_dy,
+                             float *dnoise_dz, int dstride )
+{
+    int i;
+
+    if( dnoise_dx && dnoise_dy && dnoise_dz )
+      for( i = 0; i < n; i++ )
+        STRIDED( result, i, rstride ) =
+          sdnoise3( STRIDED_IN( x, i, stride ), STRIDED_IN( y, i, stride ),
+                    STRIDED_IN( z, i, stride ),
+                    &STRIDED( dnoise_dx, i, dstride ),
+                    &STRIDED( dnoise_dy, i, dstride ),
+                    &STRIDED( dnoise_dz, i, dstride ) );
+    else
+      for( i = 0; i < n; i++ )
+        STRIDED( result, i, rstride ) =
+          sdnoise3( STRIDED_IN( x, i, stride ), STRIDED_IN( y, i, stride ),
+                    STRIDED_IN( z, i, stride ), 0, 0, 0 );
+}
+
+/* Displace vertices along their normals. The displaced surface is
+ * p + a*N(f*p)*n, and moving along it in a tangent direction u changes
+ * the displacement by a*f*(grad N . u), so the new normal is the old one
+ * tilted against the tangential part of the gradient. That is exact for
+ * flat surfaces, and close enough for smooth ones.
+ */
+void sdnoise3_displace( int n, float *pos, float *normal, int stride,
+                        float frequency, float amount )
+{
+    int i;
+
+    for( i = 0; i < n; i++ ) {
+      float *p = &STRIDED( pos, i, stride );
+      float *q = &STRIDED( normal, i, stride );
+      float nx = q[0], ny = q[1], nz = q[2];
+      float gx, gy, gz, d, gn, len;
+
+      d = amount * sdnoise3( frequency * p[0], frequency * p[1],
+                             frequency * p[2], &gx, &gy, &gz );
+      p[0] += d * nx;
+      p[1] += d * ny;
+      p[2] += d * nz;
+
+      /* Gradient of the displacement, and its part along the normal */
+      gx *= amount * frequency;
+      gy *= amount * frequency;
+      gz *= amount * frequency;
+      gn = gx * nx + gy * ny + gz * nz;
+      nx -= gx - gn * nx;
+      ny -= gy - gn * ny;
+      nz -= gz - gn * nz;
+      len = sqrtf( nx*nx + ny*ny + nz*nz );
+      if( len > 0.0f ) {
+        q[0] = nx / len;
+        q[1] = ny / len;
+        q[2] = nz / len;
+      }
+    }
+}
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * Second derivatives. Each corner contributes t^4 * (g.d) to the noise,
+ * where d is the offset from the corner, g its gradient and t = 0.5 - d.d.
+ * Differentiating the gradient -8 t^3 (g.d) d + t^4 g once more gives
+ *
+ *   H = 48 t^2 (g.d) d d^T - 8 t^3 (g d^T + d g^T) - 8 t^3 (g.d) I
+ *
+ * which is summed over the corners in the same pass as the value and the
+ * gradient, and scaled like the noise.
+ */
+
+/* Accumulate the value, gradient and Hessian terms of one 2D corner */
+static void hess2_corner( float x, float y, int hash,
+                          float *n, float *grad, float *hess )
+{
+    float t = 0.5f - x * x - y * y;
+    float gx, gy, t2, t3, gdot, a, b;
+
+    if( t < 0.0f ) return; /* No influence */
+    grad2( hash, &gx, &gy );
+    t2 = t * t;
+    t3 = t2 * t;
+    gdot = gx * x + gy * y;
+    *n += t2 * t2 * gdot;
+    grad[0] += -8.0f * t3 * gdot * x + t2 * t2 * gx;
+    grad[1] += -8.0f * t3 * gdot * y + t2 * t2 * gy;
+    a = 48.0f * t2 * gdot;
+    b = -8.0f * t3;
+    hess[0] += a * x * x + b * ( 2.0f * gx * x + gdot ); /* xx */
+    hess[1] += a * y * y + b * ( 2.0f * gy * y + gdot ); /* yy */
+    hess[2] += a * x * y + b * ( gx * y + gy * x );      /* xy */
+}
+
+/** 2D simplex noise with gradient and Hessian.
+ */
+float sdnoise2_hessian( float x, float y, float *grad, float *hess )
+{
+    float n = 0.0f, g[2] = { 0.0f, 0.0f }, h[3] = { 0.0f, 0.0f, 0.0f };
+    int c;
+
+    float s = ( x + y ) * F2;
+    float xs = x + s;
+    float ys = y + s;
+    int ii, i = FASTFLOOR( xs );
+    int jj, j = FASTFLOOR( ys );
+
+    float t = ( float ) ( i + j ) * G2;
+    float X0 = i - t;
+    float Y0 = j - t;
+    float x0 = x - X0;
+    float y0 = y - Y0;
+
+    int i1, j1;
+    if( x0 > y0 ) { i1 = 1; j1 = 0; }
+    else { i1 = 0; j1 = 1; }
+
+    ii = i & 0xff;
+    jj = j & 0xff;
+
+    hess2_corner( x0, y0, perm[ii + perm[jj]], &n, g, h );
+    hess2_corner( x0 - i1 + G2, y0 - j1 + G2,
+                  perm[ii + i1 + perm[jj + j1]], &n, g, h );
+    hess2_corner( x0 - 1.0f + 2.0f * G2, y0 - 1.0f + 2.0f * G2,
+                  perm[ii + 1 + perm[jj + 1]], &n, g, h );
+
+    if( grad )
+      for( c = 0; c < 2; c++ ) grad[c] = 40.0f * g[c];
+    if( hess )
+      for( c = 0; c < 3; c++ ) hess[c] = 40.0f * h[c];
+    return 40.0f * n;
+}
+
+/* Accumulate the value, gradient and Hessian terms of one 3D corner */
+static void hess3_corner( float x, float y, float z, int hash,
+                          float *n, float *grad, float *hess )
+{
+    float t = 0.5f - x * x - y * y - z * z;
+    float gx, gy, gz, t2, t3, gdot, a, b;
+
+    if( t < 0.0f ) return; /* No influence */
+    grad3( hash, &gx, &gy, &gz );
+    t2 = t * t;
+    t3 = t2 * t;
+    gdot = gx * x + gy * y + gz * z;
+    *n += t2 * t2 * gdot;
+    grad[0] += -8.0f * t3 * gdot * x + t2 * t2 * gx;
+    grad[1] += -8.0f * t3 * gdot * y + t2 * t2 * gy;
+    grad[2] += -8.0f * t3 * gdot * z + t2 * t2 * gz;
+    a = 48.0f * t2 * gdot;
+    b = -8.0f * t3;
+    hess[0] += a * x * x + b * ( 2.0f * gx * x + gdot ); /* xx */
+    hess[1] += a * y * y + b * ( 2.0f * gy * y + gdot ); /* yy */
+    hess[2] += a * z * z + b * ( 2.0f * gz * z + gdot ); /* zz */
+    hess[3] += a * x * y + b * ( gx * y + gy * x );      /* xy */
+    hess[4] += a * x * z + b * ( gx * z + gz * x );      /* xz */
+    hess[5] += a * y * z + b * ( gy * z + gz * y );      /* yz */
+}
+
+/** 3D simplex noise with gradient and Hessian.
+ */
+float sdnoise3_hessian( float x, float y, float z, float *grad, float *hess )
+{
+    float n = 0.0f, g[3] = { 0.0f, 0.0f, 0.0f };
+    float h[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    int c;
+
+    float s = (x+y+z)*F3;
+    float xs = x+s;
+    float ys = y+s;
+    float zs = z+s;
+    int ii, i = FASTFLOOR(xs);
+    int jj, j = FASTFLOOR(ys);
+    int kk, k = FASTFLOOR(zs);
+
+    float t = (float)(i+j+k)*G3;
+    float X0 = i-t;
+    float Y0 = j-t;
+    float Z0 = k-t;
+    float x0 = x-X0;
+    float y0 = y-Y0;
+    float z0 = z-Z0;
+
+    int i1, j1, k1;
+    int i2, j2, k2;
+
+    if(x0>=y0) {
+      if(y0>=z0)
+        { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } /* X Y Z order */
+        else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } /* X Z Y order */
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } /* Z X Y order */
+      }
+    else { // x0<y0
+      if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } /* Z Y X order */
+      else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } /* Y Z X order */
+      else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } /* Y X Z order */
+    }
+
+    ii = i & 0xff;
+    jj = j & 0xff;
+    kk = k & 0xff;
+
+    hess3_corner( x0, y0, z0, perm[ii + perm[jj + perm[kk]]], &n, g, h );
+    hess3_corner( x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3,
+                  perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]], &n, g, h );
+    hess3_corner( x0 - i2 + 2.0f * G3, y0 - j2 + 2.0f * G3,
+                  z0 - k2 + 2.0f * G3,
+                  perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]], &n, g, h );
+    hess3_corner( x0 - 1.0f + 3.0f * G3, y0 - 1.0f + 3.0f * G3,
+                  z0 - 1.0f + 3.0f * G3,
+                  perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]], &n, g, h );
+
+    if( grad )
+      for( c = 0; c < 3; c++ ) grad[c] = 72.0f * g[c];
+    if( hess )
+      for( c = 0; c < 6; c++ ) hess[c] = 72.0f * h[c];
+    return 72.0f * n;
+}
+
+/** Noise, gradient and Hessian over arrays of points.
+ */
+void sdnoise2_hessian_batch( int n, const float *x, const float *y,
+                             float *result, float *grad, float *hess )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+      result[i] = sdnoise2_hessian( x[i], y[i], grad ? grad + 2*i : 0,
+                                    hess ? hess + 3*i : 0 );
+}
+
+void sdnoise3_hessian_batch( int n, const float *x, const float *y,
+                             const float *z, float *result,
+                             float *grad, float *hess )
+{
+    int i;
+    for( i = 0; i < n; i++ )
+      result[i] = sdnoise3_hessian( x[i], y[i], z[i],
+                                    grad ? grad + 3*i : 0,
+                                    hess ? hess + 6*i : 0 );
+}
+
+/* Periodic simplex noise with derivatives. The simplex grids of sdnoise2()
+ * and sdnoise3() never repeat along the coordinate axes, so these use other
+ * lattices that do. In 2D, the lattice points are in rows one unit apart,
+ * with a spacing of one unit within each row and every second row offset
+ * by half a unit. In 3D, the lattice is the body-centered cubic lattice of
+ * all points where the coordinates are either all integers or all
+ * half-integers. Twice the position of a lattice point is always an
+ * integer, and wrapping that by twice the period before hashing makes
+ * points one period apart get the same gradient.
+ */
+
+static int pwrap( int i, int p ) {
+    if( p <= 0 ) return i; /* No period along this axis */
+    i %= p;
+    return ( i < 0 ) ? i + p : i;
+}
+
+/* Contribution from the 2D corner at offset (x,y) with the lattice point
+ * at (i - j/2, j). The derivative is added to (*dx,*dy).
+ */
+static float pcorner2( float x, float y, int i, int j, int px, int py,
+                       float *dx, float *dy ) {
+    float gx, gy, t, t2, t4, gdotp;
+    int x2;
+
+    /* The kernel is as wide as it can be without reaching beyond the
+     * corners of the triangle that the point is in. */
+    t = 0.8f - x * x - y * y;
+    if( t < 0.0f ) return 0.0f; /* No influence */
+    x2 = pwrap( 2 * i - j, 2 * px );
+    j = pwrap( j, py );
+    i = ( x2 + j ) >> 1;
+    grad2( perm[( i & 0xff ) + perm[j & 0xff]], &gx, &gy );
+    t2 = t * t;
+    t4 = t2 * t2;
+    gdotp = gx * x + gy * y;
+    *dx += -8.0f * t2 * t * gdotp * x + t4 * gx;
+    *dy += -8.0f * t2 * t * gdotp * y + t4 * gy;
+    return t4 * gdotp;
+}
+
+/* Contribution from the 3D corner at offset (x,y,z) with the lattice point
+ * at ((-i+j+k)/2, (i-j+k)/2, (i+j-k)/2).
+ */
+static float pcorner3( float x, float y, float z, int i, int j, int k,
+                       int px, int py, int pz,
+                       float *dx, float *dy, float *dz ) {
+    float gx, gy, gz, t, t2, t4, gdotp;
+    int x2, y2, z2;
+
+    t = 0.5f - x * x - y * y - z * z;
+    if( t < 0.0f ) return 0.0f; /* No influence */
+    x2 = pwrap( -i + j + k, 2 * px );
+    y2 = pwrap( i - j + k, 2 * py );
+    z2 = pwrap( i + j - k, 2 * pz );
+    grad3( perm[( ( ( y2 + z2 ) >> 1 ) & 0xff )
+                + perm[( ( ( x2 + z2 ) >> 1 ) & 0xff )
+                       + perm[( ( x2 + y2 ) >> 1 ) & 0xff]]], &gx, &gy, &gz );
+    t2 = t * t;
+    t4 = t2 * t2;
+    gdotp = gx * x + gy * y + gz * z;
+    *dx += -8.0f * t2 * t * gdotp * x + t4 * gx;
+    *dy += -8.0f * t2 * t * gdotp * y + t4 * gy;
+    *dz += -8.0f * t2 * t * gdotp * z + t4 * gz;
+    return t4 * gdotp;
+}
+
+/** 2D periodic simplex noise with derivatives.
+ */
+float psdnoise2( float x, float y, int px, int py,
+                 float *dnoise_dx, float *dnoise_dy )
+{
+    float u, fu, fv, x0, y0, noise, dx = 0.0f, dy = 0.0f;
+    int i, j, i1, j1;
+
+    py += py & 1; /* The rows only repeat every second row */
+
+    /* Skew the input space so that the lattice points are at integer (u,v) */
+    u = x + 0.5f * y;
+    i = FASTFLOOR( u );
+    j = FASTFLOOR( y );
+    fu = u - i;
+    fv = y - j;
+
+    /* The cell is split into two triangles along its diagonal */
+    if( fu > fv ) { i1 = 1; j1 = 0; }
+    else { i1 = 0; j1 = 1; }
+
+    x0 = x - ( i - 0.5f * j ); /* Offsets from the first corner */
+    y0 = fv;
+    noise = pcorner2( x0, y0, i, j, px, py, &dx, &dy )
+          + pcorner2( x0 - i1 + 0.5f * j1, y0 - j1, i + i1, j + j1, px, py,
+                      &dx, &dy )
+          + pcorner2( x0 - 0.5f, y0 - 1.0f, i + 1, j + 1, px, py, &dx, &dy );
+
+    /* The largest value is close to 0.108 (empirically determined), and
+     * the result is scaled to return values in the interval [-1,1]. */
+    if( ( dnoise_dx ) && ( dnoise_dy ) )
+      {
+        *dnoise_dx = 9.2f * dx;
+        *dnoise_dy = 9.2f * dy;
+      }
+    return 9.2f * noise;
+}
+
+/** 3D periodic simplex noise with derivatives.
+ */
+float psdnoise3( float x, float y, float z, int px, int py, int pz,
+                 float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+{
+    float u, v, w, fu, fv, fw, x0, y0, z0, noise;
+    float dx = 0.0f, dy = 0.0f, dz = 0.0f;
+    int i, j, k, i1, j1, k1, i2, j2, k2;
+
+    /* Skew the input space so that the lattice points are at integer (u,v,w) */
+    u = y + z;
+    v = x + z;
+    w = x + y;
+    i = FASTFLOOR( u );
+    j = FASTFLOOR( v );
+    k = FASTFLOOR( w );
+    fu = u - i;
+    fv = v - j;
+    fw = w - k;
+
+    /* The cube in (u,v,w) is split into six tetrahedra, like for sdnoise3() */
+    if( fu >= fv ) {
+      if( fv >= fw )
+        { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+      else if( fu >= fw )
+        { i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1; }
+      else
+        { i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1; }
+    }
+    else {
+      if( fv < fw )
+        { i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1; }
+      else if( fu < fw )
+        { i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1; }
+      else
+        { i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0; }
+    }
+
+    /* A step of 1 in u, v or w is a step of (-1,1,1)/2, (1,-1,1)/2 or
+     * (1,1,-1)/2 in (x,y,z) */
+    x0 = x - 0.5f * ( -i + j + k );
+    y0 = y - 0.5f * ( i - j + k );
+    z0 = z - 0.5f * ( i + j - k );
+    noise = pcorner3( x0, y0, z0, i, j, k, px, py, pz, &dx, &dy, &dz )
+          + pcorner3( x0 - 0.5f * ( -i1 + j1 + k1 ), y0 - 0.5f * ( i1 - j1 + k1 ),
+                      z0 - 0.5f * ( i1 + j1 - k1 ), i + i1, j + j1, k + k1,
+                      px, py, pz, &dx, &dy, &dz )
+          + pcorner3( x0 - 0.5f * ( -i2 + j2 + k2 ), y0 - 0.5f * ( i2 - j2 + k2 ),
+                      z0 - 0.5f * ( i2 + j2 - k2 ), i + i2, j + j2, k + k2,
+                      px, py, pz, &dx, &dy, &dz )
+          + pcorner3( x0 - 0.5f, y0 - 0.5f, z0 - 0.5f, i + 1, j + 1, k + 1,
+                      px, py, pz, &dx, &dy, &dz );
+
+    /* The largest value is close to 0.0130 (empirically determined) */
+    if( ( dnoise_dx ) && ( dnoise_dy ) && ( dnoise_dz ) )
+      {
+        *dnoise_dx = 76.0f * dx;
+        *dnoise_dy = 76.0f * dy;
+        *dnoise_dz = 76.0f * dz;
+      }
+    return 76.0f * noise;
+}
@@ -54,3 +54,106 @@ float sdnoise3( float x, float y, float z,
 float sdnoise4( float x, float y, float z, float w,
                 float *dnoise_dx, float *dnoise_dy,
                 float *dnoise_dz, float *dnoise_dw);
+
+/** Vector-valued 3D simplex noise with derivatives. result[0..2] are
+ * three independent channels of noise, computed from one shared traversal
+ * of the simplex grid. Channel 0 and its derivatives are exactly the same
+ * as from sdnoise3(), and channels 1 and 2 use other gradients at the same
+ * lattice points. If jacobian is not null, jacobian[3*c + a] is set to the
+ * derivative of channel c along axis a (x, y, z for a = 0, 1, 2).
+ */
+void sdnoise3_vec3( float x, float y, float z, float *result,
+                    float *jacobian );
+
+/** Vector-valued 3D simplex noise over arrays of n points, with the
+ * channels in separate arrays. If jacobian is not null, it must have room
+ * for 9*n values, and the 9 derivatives of point i are stored from
+ * jacobian[9*i] on, in the same order as for sdnoise3_vec3().
+ */
+void sdnoise3_vec3_batch( int n, const float *x, const float *y,
+                          const float *z, float *vx, float *vy, float *vz,
+                          float *jacobian );
+
+/** Domain warped 3D simplex noise with derivatives:
+ * sdnoise3( p + k*w(p) ), where the warp vector w is three channels of
+ * noise computed like sdnoise3_vec3( p ), but with gradients that all
+ * differ from those of sdnoise3().
+ * If the last three arguments are not null, the analytic
+ * derivative of the whole composition is also calculated.
+ */
+float sdnoise3_warp( float x, float y, float z, float k,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+
+/** Domain warped 3D simplex noise over arrays of n points. The derivative
+ * arrays may be null, in which case only result[] is computed.
+ */
+void sdnoise3_warp_batch( int n, const float *x, const float *y,
+                          const float *z, float k, float *result,
+                          float *dnoise_dx, float *dnoise_dy,
+                          float *dnoise_dz );
+
+/** 3D simplex noise with derivatives over arrays of n points. The
+ * derivative arrays may be null, in which case only result[] is computed,
+ * by a loop without branches that the compiler can vectorize. The values
+ * are the same as from sdnoise3(), unless the compiler contracts
+ * multiplies and adds to fused operations differently in the two.
+ */
+void sdnoise3_batch( int n, const float *x, const float *y, const float *z,
+                     float *result,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+
+/** 3D simplex noise with derivatives over strided arrays, for interleaved
+ * vertex buffers. Element i of x, y and z is stride bytes after element
+ * i-1, and the same for result with rstride and for the derivatives with
+ * dstride. The derivative pointers may be null, in which case only result
+ * is computed. With strides of sizeof(float), this is the same as calling
+ * sdnoise3() for each point.
+ */
+void sdnoise3_batch_strided( int n, const float *x, const float *y,
+                             const float *z, int stride,
+                             float *result, int rstride,
+                             float *dnoise_dx, float *dnoise_dy,
+                             float *dnoise_dz, int dstride );
+
+/** Displace n vertices of an interleaved vertex buffer in place. pos and
+ * normal point to the position and the unit normal of the first vertex,
+ * each three consecutive floats, and stride is the size of a vertex in
+ * bytes. Each position p is moved by amount * sdnoise3( frequency * p )
+ * along its normal, and the normal is tilted by the analytic gradient of
+ * the displacement and normalized again.
+ */
+void sdnoise3_displace( int n, float *pos, float *normal, int stride,
+                        float frequency, float amount );
+
+/** 2D and 3D simplex noise with first and second derivatives.
+ * The return value is the noise. If grad is not null, the gradient is
+ * stored in grad[0..1] or grad[0..2]. If hess is not null, the symmetric
+ * Hessian matrix of second derivatives is stored in hess[], as
+ * (xx, yy, xy) in 2D and as (xx, yy, zz, xy, xz, yz) in 3D.
+ * Everything is computed analytically in one pass.
+ */
+float sdnoise2_hessian( float x, float y, float *grad, float *hess );
+float sdnoise3_hessian( float x, float y, float z, float *grad, float *hess );
+
+/** Noise, gradient and Hessian over arrays of n points. The gradient and
+ * Hessian of point i are stored from grad[2*i] and hess[3*i] in 2D, and
+ * from grad[3*i] and hess[6*i] in 3D. Either array may be null.
+ */
+void sdnoise2_hessian_batch( int n, const float *x, const float *y,
+                             float *result, float *grad, float *hess );
+void sdnoise3_hessian_batch( int n, const float *x, const float *y,
+                             const float *z, float *result,
+                             float *grad, float *hess );
+
+/** 2D and 3D periodic simplex noise with derivatives, which tiles with an
+ * integer period px, py, pz along each axis. A period of 0 means no
+ * wrapping along that axis. If the derivative pointers are not null, the
+ * analytic derivative is also calculated. The lattices are not the same as
+ * for sdnoise2() and sdnoise3(), so neither are the values. In 2D, the
+ * lattice only repeats every second unit along y, and an odd py is rounded
+ * up to the next even number.
+ */
+float psdnoise2( float x, float y, int px, int py,
+                 float *dnoise_dx, float *dnoise_dy );
+float psdnoise3( float x, float y, float z, int px, int py, int pz,
+                 float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
@@ -27,6 +27,9 @@
  * header file. The header file is made for use by external code only.
  */
 
+#include <math.h>
+#include <stdlib.h>
+
 // We don't really need to include this, but play nice and do it anyway.
 #include	"simplexnoise1234.h"
 
@@ -52,7 +55,7 @@
  * A vector-valued noise over 3D accesses it 96 times, and a
  * float-valued 4D noise 64 times. We want this to fit in the cache!
  */
-unsigned char perm[512] = {151,160,137,91,90,15,
+static unsigned char perm[512] = {151,160,137,91,90,15,
   131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
   190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
   88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
@@ -95,28 +98,28 @@ unsigned char perm[512] = {151,160,137,91,90,15,
  * float SLnoise = (noise(x,y,z) + 1.0) * 0.5;
  */
 
-float  grad1( int hash, float x ) {
+static float  grad1( int hash, float x ) {
     int h = hash & 15;
     float grad = 1.0f + (h & 7);   // Gradient value 1.0, 2.0, ..., 8.0
     if (h&8) grad = -grad;         // Set a random sign for the gradient
     return ( grad * x );           // Multiply the gradient with the distance
 }
 
-float  grad2( int hash, float x, float y ) {
+static float  grad2( int hash, float x, float y ) {
     int h = hash & 7;      // Convert low 3 bits of hash code
     float u = h<4 ? x : y;  // into 8 simple gradient directions,
     float v = h<4 ? y : x;  // and compute the dot product with (x,y).
     return ((h&1)? -u : u) + ((h&2)? -2.0f*v : 2.0f*v);
 }
 
-float  grad3( int hash, float x, float y , float z ) {
+static float  grad3( int hash, float x, float y , float z ) {
     int h = hash & 15;     // Convert low 4 bits of hash code into 12 simple
     float u = h<8 ? x : y; // gradient directions, and compute dot product.
     float v = h<4 ? y : h==12||h==14 ? x : z; // Fix repeats at h = 12 to 15
     return ((h&1)? -u : u) + ((h&2)? -v : v);
 }
 
-float  grad4( int hash, float x, float y, float z, float t ) {
+static float  grad4( int hash, float x, float y, float z, float t ) {
     int h = hash & 31;      // Convert low 5 bits of hash code into 32 simple
     float u = h<24 ? x : y; // gradient directions, and compute dot product.
     float v = h<16 ? y : z;
@@ -464,3 +467,754 @@ float snoise4(float x, float y, float z, float w) {
     return 62.0f * (n0 + n1 + n2 + n3 + n4);
   }
 //---------------------------------------------------------------------
+
+// 2D and 3D simplex noise over arrays of points.
+// These are plain loops over the scalar functions above, but being in
+// the same compilation unit lets the compiler inline the noise code, and
+// they give the grid generator in "noisegen.c" one call per row of points.
+void snoise2_batch(int n, const float *x, const float *y, float *result) {
+  int i;
+  for(i = 0; i < n; i++)
+    result[i] = snoise2(x[i], y[i]);
+}
+
+void snoise3_batch(int n, const float *x, const float *y, const float *z,
+                   float *result) {
+  int i;
+  for(i = 0; i < n; i++)
+    result[i] = snoise3(x[i], y[i], z[i]);
+}
+
+// The same over strided arrays, such as the fields of interleaved vertex
+// buffers. Element i of an array is i*stride bytes after its first one.
+// STRIDED_IN() reads the const input arrays without casting the const away.
+#define STRIDED(p, i, stride) \
+  (*(float *)((char *)(p) + (size_t)(i) * (stride)))
+#define STRIDED_IN(p, i, stride) \
+  (*(const float *)((const char *)(p) + (size_t)(i) * (stride)))
+
+void snoise3_batch_strided(int n, const float *x, const float *y,
+                           const float *z, int stride,
+                           float *result, int rstride) {
+  int i;
+  for(i = 0; i < n; i++)
+    STRIDED(result, i, rstride) = snoise3(STRIDED_IN(x, i, stride),
+                                          STRIDED_IN(y, i, stride),
+                                          STRIDED_IN(z, i, stride));
+}
+//---------------------------------------------------------------------
+
+// Conservative value bounds for 3D simplex noise over an axis-aligned box.
+// snoise3() is a sum over lattice vertices of (0.5-r^2)^4 * grad3(d),
+// where d is the offset from the vertex and r = |d|, and only vertices
+// closer than sqrt(0.5) contribute. For each vertex that can reach the
+// box, the falloff and the gradient ramp are bounded separately over the
+// box, and the product bounds are summed. Each term is also bounded by
+// 72 * sqrt(2) * max(r*(0.5-r^2)^4) = 0.9364 and at most four terms are
+// non-zero, which gives a global bound for boxes with very many vertices.
+// The per-vertex bounds are loose for boxes much larger than the distance
+// between vertices, so boxes are split into up to 4x4x4 smaller pieces.
+
+#define BOUNDS_MAXVERTS 4096
+#define BOUNDS_EPS 1.0e-5f // Margin for rounding errors in snoise3()
+#define BOUNDS_SPLIT 0.25f // Target size of the pieces of a box
+#define SNOISE3_BOUND 3.746f
+
+static void grad3_range(int hash, const float *lo, const float *hi,
+                        float *gmin, float *gmax) {
+  int h = hash & 15;
+  int a = h<8 ? 0 : 1;                    // Axis of u in grad3()
+  int b = h<4 ? 1 : h==12||h==14 ? 0 : 2; // Axis of v in grad3()
+  if(h&1) { *gmin = -hi[a]; *gmax = -lo[a]; }
+  else    { *gmin =  lo[a]; *gmax =  hi[a]; }
+  if(h&2) { *gmin -= hi[b]; *gmax -= lo[b]; }
+  else    { *gmin += lo[b]; *gmax += hi[b]; }
+}
+
+// Unscaled bounds for snoise3() over the box [blo,bhi]
+static void snoise3_box_bounds(const float *blo, const float *bhi,
+                               float *nmin, float *nmax) {
+
+  const float r = 0.70710678f; // Radius of the falloff kernel
+  float dlo[3], dhi[3];
+  float sum0 = 0.0f, sum1 = 0.0f;
+  int i, j, k;
+
+  // Range of skewed lattice coordinates for vertices within r of the box
+  float smin = (blo[0] + blo[1] + blo[2] - 3.0f*r) * F3;
+  float smax = (bhi[0] + bhi[1] + bhi[2] + 3.0f*r) * F3;
+  float xs0 = blo[0] - r + smin, xs1 = bhi[0] + r + smax;
+  float ys0 = blo[1] - r + smin, ys1 = bhi[1] + r + smax;
+  float zs0 = blo[2] - r + smin, zs1 = bhi[2] + r + smax;
+  int i0 = FASTFLOOR(xs0), i1 = FASTFLOOR(xs1) + 1;
+  int j0 = FASTFLOOR(ys0), j1 = FASTFLOOR(ys1) + 1;
+  int k0 = FASTFLOOR(zs0), k1 = FASTFLOOR(zs1) + 1;
+
+  if((double)(i1 - i0 + 1) * (j1 - j0 + 1) * (k1 - k0 + 1) > BOUNDS_MAXVERTS) {
+    *nmin = -SNOISE3_BOUND / 72.0f;
+    *nmax = SNOISE3_BOUND / 72.0f;
+    return;
+  }
+
+  for(k = k0; k <= k1; k++)
+  for(j = j0; j <= j1; j++)
+  for(i = i0; i <= i1; i++) {
+    float t = (float)(i+j+k)*G3; // Unskew the vertex to (x,y,z) space
+    float p[3], near2 = 0.0f, far2 = 0.0f, wmin, wmax, gmin, gmax, rr, wr;
+    int a;
+    p[0] = i - t; p[1] = j - t; p[2] = k - t;
+
+    // Nearest and farthest squared distance from the vertex to the box
+    for(a = 0; a < 3; a++) {
+      float dn = (p[a] < blo[a]) ? blo[a] - p[a] :
+                 (p[a] > bhi[a]) ? p[a] - bhi[a] : 0.0f;
+      float df = (p[a] - blo[a] > bhi[a] - p[a]) ? p[a] - blo[a] : bhi[a] - p[a];
+      near2 += dn*dn;
+      far2 += df*df;
+      dlo[a] = blo[a] - p[a];
+      dhi[a] = bhi[a] - p[a];
+    }
+    if(near2 >= 0.5f) continue; // No influence anywhere in the box
+
+    wmax = 0.5f - near2;
+    wmax *= wmax; wmax *= wmax;
+    wmin = (far2 < 0.5f) ? 0.5f - far2 : 0.0f;
+    wmin *= wmin; wmin *= wmin;
+
+    grad3_range(perm[(i & 0xff) + perm[(j & 0xff) + perm[k & 0xff]]],
+                dlo, dhi, &gmin, &gmax);
+    gmin = (gmin < 0.0f) ? gmin * wmax : gmin * wmin;
+    gmax = (gmax > 0.0f) ? gmax * wmax : gmax * wmin;
+
+    // The term is also bounded by sqrt(2)*r*(0.5-r^2)^4, which peaks at
+    // r^2 = 1/18. This is much tighter when the box is not small.
+    rr = (near2 > 1.0f/18.0f) ? near2 : (far2 < 1.0f/18.0f) ? far2 : 1.0f/18.0f;
+    wr = 0.5f - rr;
+    wr *= wr; wr *= wr;
+    wr *= 1.41421356f * sqrtf(rr);
+    sum0 += (gmin > -wr) ? gmin : -wr;
+    sum1 += (gmax < wr) ? gmax : wr;
+  }
+  *nmin = sum0;
+  *nmax = sum1;
+}
+
+// Guaranteed bounds for snoise3() over the box [x0,x1]x[y0,y1]x[z0,z1]
+void snoise3_bounds(float x0, float y0, float z0,
+                    float x1, float y1, float z1, float *nmin, float *nmax) {
+
+  float blo[3], bhi[3], plo[3], phi[3], size[3];
+  float lo = 0.0f, hi = 0.0f, vmin, vmax, eps = 0.0f;
+  int n[3], p[3], a;
+
+  blo[0] = x0; blo[1] = y0; blo[2] = z0;
+  bhi[0] = x1; bhi[1] = y1; bhi[2] = z1;
+  for(a = 0; a < 3; a++) {
+    if(blo[a] > bhi[a]) { // Accept the corners in either order
+      float t = blo[a]; blo[a] = bhi[a]; bhi[a] = t;
+    }
+    n[a] = (int)((bhi[a] - blo[a]) * (1.0f / BOUNDS_SPLIT)) + 1;
+    if(n[a] > 4) n[a] = 4;
+    size[a] = (bhi[a] - blo[a]) / n[a];
+    // snoise3() loses precision when it unskews large coordinates, so
+    // widen the margin with the magnitude of the coordinates.
+    if(-blo[a] > eps) eps = -blo[a];
+    if(bhi[a] > eps) eps = bhi[a];
+  }
+  eps = BOUNDS_EPS + eps * 2.0e-6f;
+
+  for(p[2] = 0; p[2] < n[2]; p[2]++)
+  for(p[1] = 0; p[1] < n[1]; p[1]++)
+  for(p[0] = 0; p[0] < n[0]; p[0]++) {
+    for(a = 0; a < 3; a++) { // Let the last piece end exactly at the box edge
+      plo[a] = blo[a] + p[a] * size[a];
+      phi[a] = (p[a] == n[a] - 1) ? bhi[a] : blo[a] + (p[a] + 1) * size[a];
+    }
+    snoise3_box_bounds(plo, phi, &vmin, &vmax);
+    if(p[0] + p[1] + p[2] == 0 || vmin < lo) lo = vmin;
+    if(p[0] + p[1] + p[2] == 0 || vmax > hi) hi = vmax;
+  }
+
+  lo = 72.0f * lo - eps;
+  hi = 72.0f * hi + eps;
+  *nmin = (lo > -SNOISE3_BOUND) ? lo : -SNOISE3_BOUND;
+  *nmax = (hi < SNOISE3_BOUND) ? hi : SNOISE3_BOUND;
+}
+//---------------------------------------------------------------------
+
+// Incremental evaluation of snoise3() along a ray.
+// The unskewed origin and the hashes of the 8 corners of the current
+// skewed cube cell are kept in the ray, and they are computed again only
+// when a sample falls in another cell.
+// Each simplex in the cell uses 4 of those corners. Everything else is
+// the same arithmetic as in snoise3(), so the results are identical.
+void snoise3ray_init(snoise3ray *ray, float ox, float oy, float oz,
+                     float dx, float dy, float dz) {
+  ray->ox = ox; ray->oy = oy; ray->oz = oz;
+  ray->dx = dx; ray->dy = dy; ray->dz = dz;
+  ray->valid = 0;
+}
+
+float snoise3ray_eval(snoise3ray *ray, float t) {
+  float x = ray->ox + t*ray->dx;
+  float y = ray->oy + t*ray->dy;
+  float z = ray->oz + t*ray->dz;
+  const unsigned char *h = ray->hash;
+  float n0, n1, n2, n3;
+
+  float s = (x+y+z)*F3;
+  float xs = x+s;
+  float ys = y+s;
+  float zs = z+s;
+  int i = FASTFLOOR(xs);
+  int j = FASTFLOOR(ys);
+  int k = FASTFLOOR(zs);
+
+  int i1, j1, k1;
+  int i2, j2, k2;
+
+  // Crossed into a new cell: find its origin and look up its corner hashes
+  if(!ray->valid || i != ray->i || j != ray->j || k != ray->k) {
+    float u = (float)(i+j+k)*G3;
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
+    ray->i = i;
+    ray->j = j;
+    ray->k = k;
+    ray->valid = 1;
+    ray->X0 = i-u;
+    ray->Y0 = j-u;
+    ray->Z0 = k-u;
+    ray->hash[0] = perm[ii+perm[jj+perm[kk]]];
+    ray->hash[1] = perm[ii+perm[jj+perm[kk+1]]];
+    ray->hash[2] = perm[ii+perm[jj+1+perm[kk]]];
+    ray->hash[3] = perm[ii+perm[jj+1+perm[kk+1]]];
+    ray->hash[4] = perm[ii+1+perm[jj+perm[kk]]];
+    ray->hash[5] = perm[ii+1+perm[jj+perm[kk+1]]];
+    ray->hash[6] = perm[ii+1+perm[jj+1+perm[kk]]];
+    ray->hash[7] = perm[ii+1+perm[jj+1+perm[kk+1]]];
+  }
+
+  float x0 = x-ray->X0;
+  float y0 = y-ray->Y0;
+  float z0 = z-ray->Z0;
+
+  if(x0>=y0) {
+    if(y0>=z0)
+      { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } // X Y Z order
+      else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } // X Z Y order
+      else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } // Z X Y order
+    }
+  else { // x0<y0
+    if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } // Z Y X order
+    else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } // Y Z X order
+    else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } // Y X Z order
+  }
+
+  float x1 = x0 - i1 + G3;
+  float y1 = y0 - j1 + G3;
+  float z1 = z0 - k1 + G3;
+  float x2 = x0 - i2 + 2.0f*G3;
+  float y2 = y0 - j2 + 2.0f*G3;
+  float z2 = z0 - k2 + 2.0f*G3;
+  float x3 = x0 - 1.0f + 3.0f*G3;
+  float y3 = y0 - 1.0f + 3.0f*G3;
+  float z3 = z0 - 1.0f + 3.0f*G3;
+
+  float t0 = 0.5f - x0*x0 - y0*y0 - z0*z0;
+  if(t0 < 0.0f) n0 = 0.0f;
+  else {
+    t0 *= t0;
+    n0 = t0 * t0 * grad3(h[0], x0, y0, z0);
+  }
+
+  float t1 = 0.5f - x1*x1 - y1*y1 - z1*z1;
+  if(t1 < 0.0f) n1 = 0.0f;
+  else {
+    t1 *= t1;
+    n1 = t1 * t1 * grad3(h[4*i1+2*j1+k1], x1, y1, z1);
+  }
+
+  float t2 = 0.5f - x2*x2 - y2*y2 - z2*z2;
+  if(t2 < 0.0f) n2 = 0.0f;
+  else {
+    t2 *= t2;
+    n2 = t2 * t2 * grad3(h[4*i2+2*j2+k2], x2, y2, z2);
+  }
+
+  float t3 = 0.5f - x3*x3 - y3*y3 - z3*z3;
+  if(t3<0.0f) n3 = 0.0f;
+  else {
+    t3 *= t3;
+    n3 = t3 * t3 * grad3(h[7], x3, y3, z3);
+  }
+
+  return 72.0f * (n0 + n1 + n2 + n3);
+}
+
+void snoise3ray_march(snoise3ray *ray, float t0, float dt, int n,
+                      float *result) {
+  int i;
+  for(i = 0; i < n; i++)
+    result[i] = snoise3ray_eval(ray, t0 + i*dt);
+}
+//---------------------------------------------------------------------
+
+// Vector-valued 3D simplex noise: three channels from one traversal of
+// the simplex grid. The skewing, the corner ordering, the hashes and the
+// falloff weights are shared, and only the gradient lookups and dot
+// products are done once per channel. Channel 0 uses the ordinary corner
+// hashes and gives exactly snoise3(). Channels 1 and 2 use the hash h of
+// each corner to pick another entry perm[h+1] or perm[h+2], which gives
+// unrelated gradients at the same lattice points and so two more
+// independent noise fields. Channels first to first+2 are computed, and
+// the domain warp uses channels 1 to 3 so that none of its warp channels
+// is the warped field itself.
+#define CHANNEL_HASH(h, c) ((c) ? perm[(h) + (c)] : (h))
+
+static void snoise3_channels(float x, float y, float z, int first,
+                             float *result) {
+  float n[3][4]; // Contributions from each corner, for each channel
+  int c;
+
+  float s = (x+y+z)*F3;
+  float xs = x+s;
+  float ys = y+s;
+  float zs = z+s;
+  int i = FASTFLOOR(xs);
+  int j = FASTFLOOR(ys);
+  int k = FASTFLOOR(zs);
+
+  float t = (float)(i+j+k)*G3;
+  float X0 = i-t;
+  float Y0 = j-t;
+  float Z0 = k-t;
+  float x0 = x-X0;
+  float y0 = y-Y0;
+  float z0 = z-Z0;
+
+  int i1, j1, k1;
+  int i2, j2, k2;
+
+  if(x0>=y0) {
+    if(y0>=z0)
+      { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; } // X Y Z order
+      else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; } // X Z Y order
+      else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; } // Z X Y order
+    }
+  else { // x0<y0
+    if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; } // Z Y X order
+    else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; } // Y Z X order
+    else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; } // Y X Z order
+  }
+
+  float x1 = x0 - i1 + G3;
+  float y1 = y0 - j1 + G3;
+  float z1 = z0 - k1 + G3;
+  float x2 = x0 - i2 + 2.0f*G3;
+  float y2 = y0 - j2 + 2.0f*G3;
+  float z2 = z0 - k2 + 2.0f*G3;
+  float x3 = x0 - 1.0f + 3.0f*G3;
+  float y3 = y0 - 1.0f + 3.0f*G3;
+  float z3 = z0 - 1.0f + 3.0f*G3;
+
+  int ii = i & 0xff;
+  int jj = j & 0xff;
+  int kk = k & 0xff;
+
+  float t0 = 0.5f - x0*x0 - y0*y0 - z0*z0;
+  if(t0 < 0.0f) n[0][0] = n[1][0] = n[2][0] = 0.0f;
+  else {
+    int h = perm[ii+perm[jj+perm[kk]]];
+    t0 *= t0;
+    t0 *= t0;
+    for(c = 0; c < 3; c++)
+      n[c][0] = t0 * grad3(CHANNEL_HASH(h, first + c), x0, y0, z0);
+  }
+
+  float t1 = 0.5f - x1*x1 - y1*y1 - z1*z1;
+  if(t1 < 0.0f) n[0][1] = n[1][1] = n[2][1] = 0.0f;
+  else {
+    int h = perm[ii+i1+perm[jj+j1+perm[kk+k1]]];
+    t1 *= t1;
+    t1 *= t1;
+    for(c = 0; c < 3; c++)
+      n[c][1] = t1 * grad3(CHANNEL_HASH(h, first + c), x1, y1, z1);
+  }
+
+  float t2 = 0.5f - x2*x2 - y2*y2 - z2*z2;
+  if(t2 < 0.0f) n[0][2] = n[1][2] = n[2][2] = 0.0f;
+  else {
+    int h = perm[ii+i2+perm[jj+j2+perm[kk+k2]]];
+    t2 *= t2;
+    t2 *= t2;
+    for(c = 0; c < 3; c++)
+      n[c][2] = t2 * grad3(CHANNEL_HASH(h, first + c), x2, y2, z2);
+  }
+
+  float t3 = 0.5f - x3*x3 - y3*y3 - z3*z3;
+  if(t3 < 0.0f) n[0][3] = n[1][3] = n[2][3] = 0.0f;
+  else {
+    int h = perm[ii+1+perm[jj+1+perm[kk+1]]];
+    t3 *= t3;
+    t3 *= t3;
+    for(c = 0; c < 3; c++)
+      n[c][3] = t3 * grad3(CHANNEL_HASH(h, first + c), x3, y3, z3);
+  }
+
+  for(c = 0; c < 3; c++)
+    result[c] = 72.0f * (n[c][0] + n[c][1] + n[c][2] + n[c][3]);
+}
+
+void snoise3_vec3(float x, float y, float z, float *result) {
+  snoise3_channels(x, y, z, 0, result);
+}
+
+void snoise3_vec3_batch(int n, const float *x, const float *y, const float *z,
+                        float *vx, float *vy, float *vz) {
+  float v[3];
+  int i;
+  for(i = 0; i < n; i++) {
+    snoise3_vec3(x[i], y[i], z[i], v);
+    vx[i] = v[0];
+    vy[i] = v[1];
+    vz[i] = v[2];
+  }
+}
+
+// Domain warped 3D simplex noise. The three warp channels come from one
+// shared traversal instead of three calls to snoise3(). They are channels
+// 1 to 3, since channel 0 is snoise3() itself and would make the warp
+// vector correlated with the field it moves through.
+float snoise3_warp(float x, float y, float z, float k) {
+  float w[3];
+  snoise3_channels(x, y, z, 1, w);
+  return snoise3(x + k*w[0], y + k*w[1], z + k*w[2]);
+}
+
+void snoise3_warp_batch(int n, const float *x, const float *y, const float *z,
+                        float k, float *result) {
+  int i;
+  for(i = 0; i < n; i++)
+    result[i] = snoise3_warp(x[i], y[i], z[i], k);
+}
+//---------------------------------------------------------------------
+
+// Periodic simplex noise. The tilings of snoise2() and snoise3() never
+// repeat along the coordinate axes, so the periodic versions use other
+// lattices that do: in 2D, rows of unit-spaced points where every second
+// row is offset by half a unit, and in 3D, the body-centered cubic lattice
+// of all points with coordinates that are either all integers or all
+// half-integers. A lattice point is identified by twice its position,
+// which is always an integer, and wrapping that by twice the period
+// gives the same corner hash for points one period apart.
+
+static int pwrap(int i, int p) {
+  if(p <= 0) return i; // No period along this axis
+  i %= p;
+  return (i < 0) ? i + p : i;
+}
+
+// Hash for the 2D lattice point at (i - j/2, j)
+static int phash2(int i, int j, int px, int py) {
+  int x2 = pwrap(2*i - j, 2*px);
+  j = pwrap(j, py);
+  i = (x2 + j) >> 1;
+  return perm[(i & 0xff) + perm[j & 0xff]];
+}
+
+// Hash for the 3D lattice point at ((-i+j+k)/2, (i-j+k)/2, (i+j-k)/2)
+static int phash3(int i, int j, int k, int px, int py, int pz) {
+  int x2 = pwrap(-i + j + k, 2*px);
+  int y2 = pwrap(i - j + k, 2*py);
+  int z2 = pwrap(i + j - k, 2*pz);
+  return perm[(((y2 + z2) >> 1) & 0xff)
+              + perm[(((x2 + z2) >> 1) & 0xff) + perm[((x2 + y2) >> 1) & 0xff]]];
+}
+
+// 2D periodic simplex noise
+float psnoise2(float x, float y, int px, int py) {
+  float n0, n1, n2; // Noise contributions from the three corners
+
+  py += py & 1; // The rows only repeat every second row
+
+  // Skew the input space so that the lattice points are at integer (u,v)
+  float u = x + 0.5f*y;
+  int i = FASTFLOOR(u);
+  int j = FASTFLOOR(y);
+  float fu = u - i;
+  float fv = y - j;
+
+  // The cell is split into two triangles along its diagonal
+  int i1, j1;
+  if(fu > fv) {i1=1; j1=0;}
+  else {i1=0; j1=1;}
+
+  float x0 = x - (i - 0.5f*j); // Offsets from the corners in (x,y) coords
+  float y0 = fv;
+  float x1 = x0 - i1 + 0.5f*j1;
+  float y1 = y0 - j1;
+  float x2 = x0 - 0.5f;
+  float y2 = y0 - 1.0f;
+
+  // The triangles are larger than for snoise2(), and the kernel radius
+  // is as large as it can be without reaching beyond the next corners.
+  float t0 = 0.8f - x0*x0 - y0*y0;
+  if(t0 < 0.0f) n0 = 0.0f;
+  else {
+    t0 *= t0;
+    n0 = t0 * t0 * grad2(phash2(i, j, px, py), x0, y0);
+  }
+
+  float t1 = 0.8f - x1*x1 - y1*y1;
+  if(t1 < 0.0f) n1 = 0.0f;
+  else {
+    t1 *= t1;
+    n1 = t1 * t1 * grad2(phash2(i+i1, j+j1, px, py), x1, y1);
+  }
+
+  float t2 = 0.8f - x2*x2 - y2*y2;
+  if(t2 < 0.0f) n2 = 0.0f;
+  else {
+    t2 *= t2;
+    n2 = t2 * t2 * grad2(phash2(i+1, j+1, px, py), x2, y2);
+  }
+
+  // The result is scaled to return values in the interval [-1,1].
+  // The largest value is close to 0.189 (empirically determined).
+  return 5.25f * (n0 + n1 + n2);
+}
+
+// 3D periodic simplex noise
+float psnoise3(float x, float y, float z, int px, int py, int pz) {
+  float n0, n1, n2, n3; // Noise contributions from the four corners
+
+  // Skew the input space so that the lattice points are at integer (u,v,w)
+  float u = y + z;
+  float v = x + z;
+  float w = x + y;
+  int i = FASTFLOOR(u);
+  int j = FASTFLOOR(v);
+  int k = FASTFLOOR(w);
+  float fu = u - i;
+  float fv = v - j;
+  float fw = w - k;
+
+  // The cube in (u,v,w) is split into six tetrahedra, like for snoise3()
+  int i1, j1, k1; // Offsets for second corner of simplex in (i,j,k) coords
+  int i2, j2, k2; // Offsets for third corner of simplex in (i,j,k) coords
+  if(fu>=fv) {
+    if(fv>=fw) { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; }
+    else if(fu>=fw) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; }
+    else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; }
+  }
+  else {
+    if(fv<fw) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; }
+    else if(fu<fw) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; }
+    else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; }
+  }
+
+  // A step of 1 in u, v or w is a step of (-1,1,1)/2, (1,-1,1)/2 or
+  // (1,1,-1)/2 in (x,y,z)
+  float x0 = x - 0.5f*(-i + j + k);
+  float y0 = y - 0.5f*(i - j + k);
+  float z0 = z - 0.5f*(i + j - k);
+  float x1 = x0 - 0.5f*(-i1 + j1 + k1);
+  float y1 = y0 - 0.5f*(i1 - j1 + k1);
+  float z1 = z0 - 0.5f*(i1 + j1 - k1);
+  float x2 = x0 - 0.5f*(-i2 + j2 + k2);
+  float y2 = y0 - 0.5f*(i2 - j2 + k2);
+  float z2 = z0 - 0.5f*(i2 + j2 - k2);
+  float x3 = x0 - 0.5f;
+  float y3 = y0 - 0.5f;
+  float z3 = z0 - 0.5f;
+
+  float t0 = 0.5f - x0*x0 - y0*y0 - z0*z0;
+  if(t0 < 0.0f) n0 = 0.0f;
+  else {
+    t0 *= t0;
+    n0 = t0 * t0 * grad3(phash3(i, j, k, px, py, pz), x0, y0, z0);
+  }
+
+  float t1 = 0.5f - x1*x1 - y1*y1 - z1*z1;
+  if(t1 < 0.0f) n1 = 0.0f;
+  else {
+    t1 *= t1;
+    n1 = t1 * t1 * grad3(phash3(i+i1, j+j1, k+k1, px, py, pz), x1, y1, z1);
+  }
+
+  float t2 = 0.5f - x2*x2 - y2*y2 - z2*z2;
+  if(t2 < 0.0f) n2 = 0.0f;
+  else {
+    t2 *= t2;
+    n2 = t2 * t2 * grad3(phash3(i+i2, j+j2, k+k2, px, py, pz), x2, y2, z2);
+  }
+
+  float t3 = 0.5f - x3*x3 - y3*y3 - z3*z3;
+  if(t3 < 0.0f) n3 = 0.0f;
+  else {
+    t3 *= t3;
+    n3 = t3 * t3 * grad3(phash3(i+1, j+1, k+1, px, py, pz), x3, y3, z3);
+  }
+
+  // The result is scaled to return values in the interval [-1,1].
+  // The largest value is close to 0.0130 (empirically determined).
+  return 76.0f * (n0 + n1 + n2 + n3);
+}
+//---------------------------------------------------------------------
+
+// 4D simplex noise at fixed xyz positions, swept along w.
+// The sum x+y+z that goes into the skew factor is stored for each voxel,
+// and so are the hashes of the five simplex corners. Small steps in w
+// mostly stay within the same simplex, and then the hashes are reused.
+// The arithmetic is otherwise the same as in snoise4().
+int snoise4anim_init(snoise4anim *sa, int n, const float *x,
+                     const float *y, const float *z) {
+  int i;
+  sa->n = n;
+  sa->pos = (float *)malloc(4 * (size_t)n * sizeof(float));
+  sa->cell = (int *)malloc(4 * (size_t)n * sizeof(int));
+  sa->order = (signed char *)malloc((size_t)n);
+  sa->hash = (unsigned char *)malloc(5 * (size_t)n);
+  if(!sa->pos || !sa->cell || !sa->order || !sa->hash) {
+    snoise4anim_free(sa);
+    return -1;
+  }
+  for(i = 0; i < n; i++) {
+    sa->pos[4*i] = x[i];
+    sa->pos[4*i+1] = y[i];
+    sa->pos[4*i+2] = z[i];
+    sa->pos[4*i+3] = x[i] + y[i] + z[i];
+    sa->order[i] = -1; // No hashes yet
+  }
+  return 0;
+}
+
+void snoise4anim_free(snoise4anim *sa) {
+  free(sa->pos);
+  free(sa->cell);
+  free(sa->order);
+  free(sa->hash);
+  sa->pos = 0;
+  sa->cell = 0;
+  sa->order = 0;
+  sa->hash = 0;
+}
+
+void snoise4anim_eval(snoise4anim *sa, float w, float *result) {
+  int v;
+  for(v = 0; v < sa->n; v++) {
+    const float *p = sa->pos + 4*v;
+    int *cell = sa->cell + 4*v;
+    unsigned char *h = sa->hash + 5*v;
+    float x = p[0], y = p[1], z = p[2];
+    float n0, n1, n2, n3, n4;
+
+    float s = (p[3] + w) * F4; // Same as (x + y + z + w) * F4
+    float xs = x + s;
+    float ys = y + s;
+    float zs = z + s;
+    float ws = w + s;
+    int i = FASTFLOOR(xs);
+    int j = FASTFLOOR(ys);
+    int k = FASTFLOOR(zs);
+    int l = FASTFLOOR(ws);
+
+    float t = (i + j + k + l) * G4;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+    float z0 = z - (k - t);
+    float w0 = w - (l - t);
+
+    int c = ((x0 > y0) ? 32 : 0) + ((x0 > z0) ? 16 : 0) + ((y0 > z0) ? 8 : 0)
+      + ((x0 > w0) ? 4 : 0) + ((y0 > w0) ? 2 : 0) + ((z0 > w0) ? 1 : 0);
+
+    int i1 = simplex[c][0]>=3 ? 1 : 0;
+    int j1 = simplex[c][1]>=3 ? 1 : 0;
+    int k1 = simplex[c][2]>=3 ? 1 : 0;
+    int l1 = simplex[c][3]>=3 ? 1 : 0;
+    int i2 = simplex[c][0]>=2 ? 1 : 0;
+    int j2 = simplex[c][1]>=2 ? 1 : 0;
+    int k2 = simplex[c][2]>=2 ? 1 : 0;
+    int l2 = simplex[c][3]>=2 ? 1 : 0;
+    int i3 = simplex[c][0]>=1 ? 1 : 0;
+    int j3 = simplex[c][1]>=1 ? 1 : 0;
+    int k3 = simplex[c][2]>=1 ? 1 : 0;
+    int l3 = simplex[c][3]>=1 ? 1 : 0;
+
+    // Moved into another simplex: look up the hashes of its corners
+    if(sa->order[v] != c || cell[0] != i || cell[1] != j
+       || cell[2] != k || cell[3] != l) {
+      int ii = i & 0xff;
+      int jj = j & 0xff;
+      int kk = k & 0xff;
+      int ll = l & 0xff;
+      cell[0] = i;
+      cell[1] = j;
+      cell[2] = k;
+      cell[3] = l;
+      sa->order[v] = c;
+      h[0] = perm[ii+perm[jj+perm[kk+perm[ll]]]];
+      h[1] = perm[ii+i1+perm[jj+j1+perm[kk+k1+perm[ll+l1]]]];
+      h[2] = perm[ii+i2+perm[jj+j2+perm[kk+k2+perm[ll+l2]]]];
+      h[3] = perm[ii+i3+perm[jj+j3+perm[kk+k3+perm[ll+l3]]]];
+      h[4] = perm[ii+1+perm[jj+1+perm[kk+1+perm[ll+1]]]];
+    }
+
+    float x1 = x0 - i1 + G4;
+    float y1 = y0 - j1 + G4;
+    float z1 = z0 - k1 + G4;
+    float w1 = w0 - l1 + G4;
+    float x2 = x0 - i2 + 2.0f*G4;
+    float y2 = y0 - j2 + 2.0f*G4;
+    float z2 = z0 - k2 + 2.0f*G4;
+    float w2 = w0 - l2 + 2.0f*G4;
+    float x3 = x0 - i3 + 3.0f*G4;
+    float y3 = y0 - j3 + 3.0f*G4;
+    float z3 = z0 - k3 + 3.0f*G4;
+    float w3 = w0 - l3 + 3.0f*G4;
+    float x4 = x0 - 1.0f + 4.0f*G4;
+    float y4 = y0 - 1.0f + 4.0f*G4;
+    float z4 = z0 - 1.0f + 4.0f*G4;
+    float w4 = w0 - 1.0f + 4.0f*G4;
+
+    float t0 = 0.5f - x0*x0 - y0*y0 - z0*z0 - w0*w0;
+    if(t0 < 0.0f) n0 = 0.0f;
+    else {
+      t0 *= t0;
+      n0 = t0 * t0 * grad4(h[0], x0, y0, z0, w0);
+    }
+
+    float t1 = 0.5f - x1*x1 - y1*y1 - z1*z1 - w1*w1;
+    if(t1 < 0.0f) n1 = 0.0f;
+    else {
+      t1 *= t1;
+      n1 = t1 * t1 * grad4(h[1], x1, y1, z1, w1);
+    }
+
+    float t2 = 0.5f - x2*x2 - y2*y2 - z2*z2 - w2*w2;
+    if(t2 < 0.0f) n2 = 0.0f;
+    else {
+      t2 *= t2;
+      n2 = t2 * t2 * grad4(h[2], x2, y2, z2, w2);
+    }
+
+    float t3 = 0.5f - x3*x3 - y3*y3 - z3*z3 - w3*w3;
+    if(t3 < 0.0f) n3 = 0.0f;
+    else {
+      t3 *= t3;
+      n3 = t3 * t3 * grad4(h[3], x3, y3, z3, w3);
+    }
+
+    float t4 = 0.5f - x4*x4 - y4*y4 - z4*z4 - w4*w4;
+    if(t4 < 0.0f) n4 = 0.0f;
+    else {
+      t4 *= t4;
+      n4 = t4 * t4 * grad4(h[4], x4, y4, z4, w4);
+    }
+
+    result[v] = 62.0f * (n0 + n1 + n2 + n3 + n4);
+  }
+}
+//---------------------------------------------------------------------
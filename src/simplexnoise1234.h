@@ -29,3 +29,112 @@
     float snoise2( float x, float y );
     float snoise3( float x, float y, float z );
     float snoise4( float x, float y, float z, float w );
+
+/** 2D and 3D float Perlin simplex noise over arrays of n points.
+ * result[i] is the noise value at (x[i], y[i]) or (x[i], y[i], z[i]).
+ */
+    void snoise2_batch( int n, const float *x, const float *y, float *result );
+    void snoise3_batch( int n, const float *x, const float *y, const float *z,
+                        float *result );
+
+/** 3D simplex noise over strided arrays, which lets the noise be computed
+ * directly from and into interleaved vertex buffers with no copying.
+ * Element i of x, y and z is stride bytes after element i-1, and the same
+ * for result with rstride. For a buffer of vertices with the position in
+ * the first three floats, pass x = &vertex[0].pos[0], y = x + 1, z = x + 2
+ * and stride = sizeof(vertex). With strides of sizeof(float), this is the
+ * same as snoise3_batch().
+ */
+    void snoise3_batch_strided( int n, const float *x, const float *y,
+                                const float *z, int stride,
+                                float *result, int rstride );
+
+/** Guaranteed lower and upper bounds for snoise3() over the axis-aligned
+ * box [x0,x1]x[y0,y1]x[z0,z1]. The bounds are conservative: every value
+ * of snoise3() in the box is within [*nmin, *nmax], but the true range
+ * may be smaller. The cost grows with the size of the box, and for very
+ * large boxes a fixed global bound is returned. The two corners
+ * may be given in either order.
+ */
+    void snoise3_bounds( float x0, float y0, float z0,
+                         float x1, float y1, float z1,
+                         float *nmin, float *nmax );
+
+/** Incremental evaluation of snoise3() at points o + t*d along a ray.
+ * The ray remembers the origin and the corner hashes of the last skewed
+ * lattice cell it was evaluated in, so consecutive samples within one
+ * cell skip the unskewing and the permutation table lookups. The values
+ * are identical to those of snoise3( ox + t*dx, oy + t*dy, oz + t*dz ).
+ * Use one snoise3ray for each ray being marched, and do not share it
+ * between threads.
+ */
+    typedef struct {
+      float ox, oy, oz;       // Ray origin
+      float dx, dy, dz;       // Ray direction
+      int i, j, k;            // Skewed cell of the cached hashes
+      int valid;              // Nonzero when the rest is for cell (i,j,k)
+      float X0, Y0, Z0;       // Cell origin, unskewed to (x,y,z) space
+      unsigned char hash[8];  // Corner hashes, corner (a,b,c) at [4*a+2*b+c]
+    } snoise3ray;
+
+    void snoise3ray_init( snoise3ray *ray, float ox, float oy, float oz,
+                          float dx, float dy, float dz );
+    float snoise3ray_eval( snoise3ray *ray, float t );
+
+/** Evaluate snoise3ray_eval() at n steps t0, t0+dt, t0+2*dt, ...
+ */
+    void snoise3ray_march( snoise3ray *ray, float t0, float dt, int n,
+                           float *result );
+
+/** Vector-valued 3D simplex noise, for displacement or color variation.
+ * result[0..2] are three independent channels of simplex noise at (x,y,z),
+ * computed from one shared traversal of the simplex grid, which costs much
+ * less than three calls to snoise3(). Channel 0 is the same as snoise3(),
+ * and channels 1 and 2 use other gradients at the same lattice points.
+ * The batch form stores the channels in separate arrays vx, vy and vz.
+ */
+    void snoise3_vec3( float x, float y, float z, float *result );
+    void snoise3_vec3_batch( int n, const float *x, const float *y,
+                             const float *z, float *vx, float *vy, float *vz );
+
+/** Domain warped 3D simplex noise: snoise3( p + k*w(p) ), where the warp
+ * vector w is three channels of noise computed like snoise3_vec3( p ), but
+ * with gradients that all differ from those of snoise3().
+ */
+    float snoise3_warp( float x, float y, float z, float k );
+    void snoise3_warp_batch( int n, const float *x, const float *y,
+                             const float *z, float k, float *result );
+
+/** Periodic 2D and 3D simplex noise, which tiles with an integer period
+ * px, py, pz along each axis. A period of 0 means no wrapping along that
+ * axis. These use a different lattice than snoise2() and snoise3(), one
+ * that repeats along the axes, so the values are not the same as theirs.
+ * The 2D lattice only repeats every second unit along y, and an odd py
+ * is rounded up to the next even number.
+ */
+    float psnoise2( float x, float y, int px, int py );
+    float psnoise3( float x, float y, float z, int px, int py, int pz );
+
+/** Animated 4D simplex noise over a fixed set of n voxels, for volumes
+ * that are swept along w with small time steps. snoise4anim_eval() sets
+ * result[i] to snoise4( x[i], y[i], z[i], w ), with identical values.
+ * The part of the skew factor that comes from x, y and z is stored for
+ * each voxel, and so are the corner hashes of the simplex the voxel was
+ * last evaluated in, which are reused while w stays within that simplex.
+ * snoise4anim_init() returns 0 on success, -1 if out of memory.
+ * A snoise4anim is updated by snoise4anim_eval(), so it should not be
+ * shared between threads. For looping animation, see noise4anim in
+ * "noise1234.h", which is built on the periodic pnoise4().
+ */
+    typedef struct {
+      int n;                // Number of voxels
+      float *pos;           // x, y, z and x+y+z of each voxel
+      int *cell;            // Skewed cell i, j, k, l of the cached hashes
+      signed char *order;   // Simplex index of the cached hashes, -1 if none
+      unsigned char *hash;  // Hashes of the five simplex corners
+    } snoise4anim;
+
+    int snoise4anim_init( snoise4anim *sa, int n, const float *x,
+                          const float *y, const float *z );
+    void snoise4anim_free( snoise4anim *sa );
+    void snoise4anim_eval( snoise4anim *sa, float w, float *result );
@@ -43,8 +43,9 @@
  */
 
 #include <math.h>
+#include <stdlib.h>
 
-#include "srdnoise23.h" /* We strictly don't need this, but play nice. */
+#include "srdnoise23.h" /* For the srdgrad2 and srdgrad3 types */
 
 #define FASTFLOOR(x) ( ((int)(x)<=(x)) ? ((int)x) : (((int)x)-1) )
 
@@ -173,17 +174,42 @@ float graddotp3( float gx, float gy, float gz, float x, float y, float z ) {
 #define F2 0.366025403
 #define G2 0.211324865
 
-/** 2D simplex noise with rotating gradients.
- * If the last two arguments are not null, the analytic derivative
- * (the 2D gradient of the total noise field) is also calculated.
+/*
+ * Rotated gradient for a corner, either looked up in a table that was set
+ * up by srdgrad2_set() or srdgrad3_set(), or rotated here if rg is null.
  */
-float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_dy )
+static void cornergrad2( int hash, const srdgrad2 *rg, float sin_t, float cos_t,
+                         float *gx, float *gy ) {
+    if( rg ) {
+      int h = hash & 7;
+      *gx = rg->grad[h][0];
+      *gy = rg->grad[h][1];
+    }
+    else gradrot2( hash, sin_t, cos_t, gx, gy );
+}
+
+static void cornergrad3( int hash, const srdgrad3 *rg, float sin_t, float cos_t,
+                         float *gx, float *gy, float *gz ) {
+    if( rg ) {
+      int h = hash & 15;
+      *gx = rg->grad[h][0];
+      *gy = rg->grad[h][1];
+      *gz = rg->grad[h][2];
+    }
+    else gradrot3( hash, sin_t, cos_t, gx, gy, gz );
+}
+
+/*
+ * 2D simplex noise with rotating gradients, shared by srdnoise2() and
+ * srdnoise2_rot(). The gradients come from rg if it is not null, and are
+ * otherwise rotated by the angle with sine sin_t and cosine cos_t.
+ */
+static float srdnoise2_core( float x, float y, const srdgrad2 *rg,
+                             float sin_t, float cos_t,
+                             float *dnoise_dx, float *dnoise_dy )
   {
     float n0, n1, n2; /* Noise contributions from the three simplex corners */
     float gx0, gy0, gx1, gy1, gx2, gy2; /* Gradients at simplex corners */
-    float sin_t, cos_t; /* Sine and cosine for the gradient rotation angle */
-    sin_t = sin( angle );
-    cos_t = cos( angle );
 
     /* Skew the input space to determine which simplex cell we're in */
     float s = ( x + y ) * F2; /* Hairy factor for 2D */
@@ -213,15 +239,15 @@ float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_
     float y2 = y0 - 1.0f + 2.0f * G2;
 
     /* Wrap the integer indices at 256, to avoid indexing perm[] out of bounds */
-    int ii = i % 256;
-    int jj = j % 256;
+    int ii = i & 0xff;
+    int jj = j & 0xff;
 
     /* Calculate the contribution from the three corners */
     float t0 = 0.5f - x0 * x0 - y0 * y0;
     float t20, t40;
     if( t0 < 0.0f ) t40 = t20 = t0 = n0 = gx0 = gy0 = 0.0f; /* No influence */
     else {
-      gradrot2( perm[ii + perm[jj]], sin_t, cos_t, &gx0, &gy0 );
+      cornergrad2( perm[ii + perm[jj]], rg, sin_t, cos_t, &gx0, &gy0 );
       t20 = t0 * t0;
       t40 = t20 * t20;
       n0 = t40 * graddotp2( gx0, gy0, x0, y0 );
@@ -231,7 +257,7 @@ float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_
     float t21, t41;
     if( t1 < 0.0f ) t21 = t41 = t1 = n1 = gx1 = gy1 = 0.0f; /* No influence */
     else {
-      gradrot2( perm[ii + i1 + perm[jj + j1]], sin_t, cos_t, &gx1, &gy1 );
+      cornergrad2( perm[ii + i1 + perm[jj + j1]], rg, sin_t, cos_t, &gx1, &gy1 );
       t21 = t1 * t1;
       t41 = t21 * t21;
       n1 = t41 * graddotp2( gx1, gy1, x1, y1 );
@@ -241,7 +267,7 @@ float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_
     float t22, t42;
     if( t2 < 0.0f ) t42 = t22 = t2 = n2 = gx2 = gy2 = 0.0f; /* No influence */
     else {
-      gradrot2( perm[ii + 1 + perm[jj + 1]], sin_t, cos_t, &gx2, &gy2 );
+      cornergrad2( perm[ii + 1 + perm[jj + 1]], rg, sin_t, cos_t, &gx2, &gy2 );
       t22 = t2 * t2;
       t42 = t22 * t22;
       n2 = t42 * graddotp2( gx2, gy2, x2, y2 );
@@ -289,16 +315,18 @@ float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_
 #define F3 0.333333333
 #define G3 0.166666667
 
-float srdnoise3( float x, float y, float z, float angle,
-                 float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+/*
+ * 3D simplex noise with rotating gradients, shared by srdnoise3() and
+ * srdnoise3_rot(), like srdnoise2_core().
+ */
+static float srdnoise3_core( float x, float y, float z, const srdgrad3 *rg,
+                             float sin_t, float cos_t,
+                             float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
   {
     float n0, n1, n2, n3; /* Noise contributions from the four simplex corners */
     float noise;          /* Return value */
     float gx0, gy0, gz0, gx1, gy1, gz1; /* Gradients at simplex corners */
     float gx2, gy2, gz2, gx3, gy3, gz3;
-    float sin_t, cos_t; /* Sine and cosine for the gradient rotation angle */
-    sin_t = sin( angle );
-    cos_t = cos( angle );
 
     /* Skew the input space to determine which simplex cell we're in */
     float s = (x+y+z)*F3; /* Very nice and simple skew factor for 3D */
@@ -351,16 +379,16 @@ float srdnoise3( float x, float y, float z, float angle,
     float z3 = z0 - 1.0f + 3.0f * G3;
 
     /* Wrap the integer indices at 256, to avoid indexing perm[] out of bounds */
-    int ii = i % 256;
-    int jj = j % 256;
-    int kk = k % 256;
+    int ii = i & 0xff;
+    int jj = j & 0xff;
+    int kk = k & 0xff;
 
     /* Calculate the contribution from the four corners */
     float t0 = 0.5f - x0*x0 - y0*y0 - z0*z0;
     float t20, t40;
     if(t0 < 0.0f) n0 = t0 = t20 = t40 = gx0 = gy0 = gz0 = 0.0f;
     else {
-      gradrot3( perm[ii + perm[jj + perm[kk]]], sin_t, cos_t, &gx0, &gy0, &gz0 );
+      cornergrad3( perm[ii + perm[jj + perm[kk]]], rg, sin_t, cos_t, &gx0, &gy0, &gz0 );
       t20 = t0 * t0;
       t40 = t20 * t20;
       n0 = t40 * graddotp3( gx0, gy0, gz0, x0, y0, z0 );
@@ -370,7 +398,7 @@ float srdnoise3( float x, float y, float z, float angle,
     float t21, t41;
     if(t1 < 0.0f) n1 = t1 = t21 = t41 = gx1 = gy1 = gz1 = 0.0f;
     else {
-      gradrot3( perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]], sin_t, cos_t, &gx1, &gy1, &gz1 );
+      cornergrad3( perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]], rg, sin_t, cos_t, &gx1, &gy1, &gz1 );
       t21 = t1 * t1;
       t41 = t21 * t21;
       n1 = t41 * graddotp3( gx1, gy1, gz1, x1, y1, z1 );
@@ -380,7 +408,7 @@ float srdnoise3( float x, float y, float z, float angle,
     float t22, t42;
     if(t2 < 0.0f) n2 = t2 = t22 = t42 = gx2 = gy2 = gz2 = 0.0f;
     else {
-      gradrot3( perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]], sin_t, cos_t, &gx2, &gy2, &gz2 );
+      cornergrad3( perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]], rg, sin_t, cos_t, &gx2, &gy2, &gz2 );
       t22 = t2 * t2;
       t42 = t22 * t22;
       n2 = t42 * graddotp3( gx2, gy2, gz2, x2, y2, z2 );
@@ -390,7 +418,7 @@ float srdnoise3( float x, float y, float z, float angle,
     float t23, t43;
     if(t3 < 0.0f) n3 = t3 = t23 = t43 = gx3 = gy3 = gz3 = 0.0f;
     else {
-      gradrot3( perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]], sin_t, cos_t, &gx3, &gy3, &gz3 );
+      cornergrad3( perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]], rg, sin_t, cos_t, &gx3, &gy3, &gz3 );
       t23 = t3 * t3;
       t43 = t23 * t23;
       n3 = t43 * graddotp3( gx3, gy3, gz3, x3, y3, z3 );
@@ -447,3 +475,428 @@ float srdnoise3( float x, float y, float z, float angle,
       }
     return noise;
   }
+
+/** 2D simplex noise with rotating gradients.
+ * If the last two arguments are not null, the analytic derivative
+ * (the 2D gradient of the total noise field) is also calculated.
+ */
+float srdnoise2( float x, float y, float angle, float *dnoise_dx, float *dnoise_dy )
+  {
+    return srdnoise2_core( x, y, 0, sin( angle ), cos( angle ),
+                           dnoise_dx, dnoise_dy );
+  }
+
+/** 3D simplex noise with rotating gradients.
+ * If the last three arguments are not null, the analytic derivative
+ * (the 3D gradient of the total noise field) is also calculated.
+ */
+float srdnoise3( float x, float y, float z, float angle,
+                 float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+  {
+    return srdnoise3_core( x, y, z, 0, sin( angle ), cos( angle ),
+                           dnoise_dx, dnoise_dy, dnoise_dz );
+  }
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * Rotated gradient tables. For one angle, there are only 8 distinct
+ * rotated gradients in 2D and 16 in 3D, so they can be rotated once and
+ * then looked up for every corner of every sample. The values are exactly
+ * the same as when gradrot2() and gradrot3() rotate them at each corner.
+ */
+
+void srdgrad2_set( srdgrad2 *rg, float angle )
+  {
+    float sin_t = sin( angle );
+    float cos_t = cos( angle );
+    int h;
+    rg->angle = angle;
+    for( h = 0; h < 8; h++ )
+      gradrot2( h, sin_t, cos_t, &rg->grad[h][0], &rg->grad[h][1] );
+  }
+
+void srdgrad3_set( srdgrad3 *rg, float angle )
+  {
+    float sin_t = sin( angle );
+    float cos_t = cos( angle );
+    int h;
+    rg->angle = angle;
+    for( h = 0; h < 16; h++ )
+      gradrot3( h, sin_t, cos_t,
+                &rg->grad[h][0], &rg->grad[h][1], &rg->grad[h][2] );
+  }
+
+float srdnoise2_rot( const srdgrad2 *rg, float x, float y,
+                     float *dnoise_dx, float *dnoise_dy )
+  {
+    return srdnoise2_core( x, y, rg, 0.0f, 0.0f, dnoise_dx, dnoise_dy );
+  }
+
+float srdnoise3_rot( const srdgrad3 *rg, float x, float y, float z,
+                     float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+  {
+    return srdnoise3_core( x, y, z, rg, 0.0f, 0.0f,
+                           dnoise_dx, dnoise_dy, dnoise_dz );
+  }
+
+/* The derivative arrays may be null, in which case only result[] is
+ * computed. */
+void srdnoise2_rot_batch( const srdgrad2 *rg, int n,
+                          const float *x, const float *y, float *result,
+                          float *dnoise_dx, float *dnoise_dy )
+  {
+    int i, d = dnoise_dx && dnoise_dy;
+    for( i = 0; i < n; i++ )
+      result[i] = srdnoise2_core( x[i], y[i], rg, 0.0f, 0.0f,
+                                  d ? dnoise_dx + i : 0,
+                                  d ? dnoise_dy + i : 0 );
+  }
+
+void srdnoise3_rot_batch( const srdgrad3 *rg, int n,
+                          const float *x, const float *y, const float *z,
+                          float *result, float *dnoise_dx,
+                          float *dnoise_dy, float *dnoise_dz )
+  {
+    int i, d = dnoise_dx && dnoise_dy && dnoise_dz;
+    for( i = 0; i < n; i++ )
+      result[i] = srdnoise3_core( x[i], y[i], z[i], rg, 0.0f, 0.0f,
+                                  d ? dnoise_dx + i : 0,
+                                  d ? dnoise_dy + i : 0,
+                                  d ? dnoise_dz + i : 0 );
+  }
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * Prepared sample sets. When the same points are evaluated in every frame
+ * and only the angle changes, everything except the gradients is the same
+ * from frame to frame: the simplex, the offsets from its corners, the
+ * falloff weights and the corner hashes. srdprep2_init() and
+ * srdprep3_init() compute those once, with exactly the same arithmetic as
+ * srdnoise2() and srdnoise3(), and each frame then only needs the rotated
+ * gradients and the dot products. Corners without influence are stored
+ * with zero weights.
+ */
+
+int srdprep2_init( srdprep2 *sp, int n, const float *px, const float *py )
+  {
+    int p;
+    sp->n = n;
+    sp->hash = (unsigned char *)malloc( 3 * n * sizeof( unsigned char ) );
+    sp->x = (float *)malloc( 4 * 3 * n * sizeof( float ) );
+    if( !sp->hash || !sp->x ) {
+      srdprep2_free( sp );
+      return -1;
+    }
+    sp->y = sp->x + 3 * n;
+    sp->t3 = sp->y + 3 * n;
+    sp->t4 = sp->t3 + 3 * n;
+
+    for( p = 0; p < n; p++ ) {
+      float x = px[p], y = py[p];
+      float cx[3], cy[3];
+      int h[3], c;
+
+      /* The same simplex and corners as in srdnoise2_core() */
+      float s = ( x + y ) * F2;
+      float xs = x + s;
+      float ys = y + s;
+      int i = FASTFLOOR( xs );
+      int j = FASTFLOOR( ys );
+      float t = ( float ) ( i + j ) * G2;
+      float X0 = i - t;
+      float Y0 = j - t;
+      float x0 = x - X0;
+      float y0 = y - Y0;
+      int i1, j1;
+      if( x0 > y0 ) { i1 = 1; j1 = 0; }
+      else { i1 = 0; j1 = 1; }
+      int ii = i & 0xff;
+      int jj = j & 0xff;
+
+      cx[0] = x0;
+      cy[0] = y0;
+      cx[1] = x0 - i1 + G2;
+      cy[1] = y0 - j1 + G2;
+      cx[2] = x0 - 1.0f + 2.0f * G2;
+      cy[2] = y0 - 1.0f + 2.0f * G2;
+      h[0] = perm[ii + perm[jj]];
+      h[1] = perm[ii + i1 + perm[jj + j1]];
+      h[2] = perm[ii + 1 + perm[jj + 1]];
+
+      for( c = 0; c < 3; c++ ) {
+        int m = 3 * p + c;
+        float tc = 0.5f - cx[c] * cx[c] - cy[c] * cy[c];
+        if( tc < 0.0f ) tc = 0.0f; /* No influence */
+        sp->hash[m] = h[c] & 7;
+        sp->x[m] = cx[c];
+        sp->y[m] = cy[c];
+        sp->t3[m] = tc * tc * tc;
+        sp->t4[m] = ( tc * tc ) * ( tc * tc );
+      }
+    }
+    return 0;
+  }
+
+void srdprep2_free( srdprep2 *sp )
+  {
+    free( sp->hash );
+    free( sp->x );
+    sp->hash = 0;
+    sp->x = sp->y = sp->t3 = sp->t4 = 0;
+  }
+
+/* The sums are done in the same order as in srdnoise2_core(), so the
+ * results are identical to srdnoise2() at the same angle. */
+void srdprep2_eval( const srdprep2 *sp, float angle, float *result,
+                    float *dnoise_dx, float *dnoise_dy )
+  {
+    srdgrad2 rg;
+    int p, d = dnoise_dx && dnoise_dy;
+
+    srdgrad2_set( &rg, angle );
+    for( p = 0; p < sp->n; p++ ) {
+      const unsigned char *h = sp->hash + 3 * p;
+      const float *x = sp->x + 3 * p, *y = sp->y + 3 * p;
+      const float *t3 = sp->t3 + 3 * p, *t4 = sp->t4 + 3 * p;
+      const float *g0 = rg.grad[h[0]], *g1 = rg.grad[h[1]], *g2 = rg.grad[h[2]];
+      float gd0 = graddotp2( g0[0], g0[1], x[0], y[0] );
+      float gd1 = graddotp2( g1[0], g1[1], x[1], y[1] );
+      float gd2 = graddotp2( g2[0], g2[1], x[2], y[2] );
+
+      result[p] = 40.0f * ( t4[0] * gd0 + t4[1] * gd1 + t4[2] * gd2 );
+      if( d ) {
+        float temp0 = t3[0] * gd0, temp1 = t3[1] * gd1, temp2 = t3[2] * gd2;
+        float ddx = temp0 * x[0], ddy = temp0 * y[0];
+        ddx += temp1 * x[1];
+        ddy += temp1 * y[1];
+        ddx += temp2 * x[2];
+        ddy += temp2 * y[2];
+        ddx *= -8.0f;
+        ddy *= -8.0f;
+        ddx += t4[0] * g0[0] + t4[1] * g1[0] + t4[2] * g2[0];
+        ddy += t4[0] * g0[1] + t4[1] * g1[1] + t4[2] * g2[1];
+        dnoise_dx[p] = 40.0f * ddx;
+        dnoise_dy[p] = 40.0f * ddy;
+      }
+    }
+  }
+
+int srdprep3_init( srdprep3 *sp, int n,
+                   const float *px, const float *py, const float *pz )
+  {
+    int p;
+    sp->n = n;
+    sp->hash = (unsigned char *)malloc( 4 * n * sizeof( unsigned char ) );
+    sp->x = (float *)malloc( 5 * 4 * n * sizeof( float ) );
+    if( !sp->hash || !sp->x ) {
+      srdprep3_free( sp );
+      return -1;
+    }
+    sp->y = sp->x + 4 * n;
+    sp->z = sp->y + 4 * n;
+    sp->t3 = sp->z + 4 * n;
+    sp->t4 = sp->t3 + 4 * n;
+
+    for( p = 0; p < n; p++ ) {
+      float x = px[p], y = py[p], z = pz[p];
+      float cx[4], cy[4], cz[4];
+      int h[4], c;
+
+      /* The same simplex and corners as in srdnoise3_core() */
+      float s = (x+y+z)*F3;
+      float xs = x+s;
+      float ys = y+s;
+      float zs = z+s;
+      int i = FASTFLOOR(xs);
+      int j = FASTFLOOR(ys);
+      int k = FASTFLOOR(zs);
+      float t = (float)(i+j+k)*G3;
+      float X0 = i-t;
+      float Y0 = j-t;
+      float Z0 = k-t;
+      float x0 = x-X0;
+      float y0 = y-Y0;
+      float z0 = z-Z0;
+      int i1, j1, k1, i2, j2, k2;
+      if(x0>=y0) {
+        if(y0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; }
+        else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; }
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; }
+      }
+      else {
+        if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; }
+        else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; }
+        else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; }
+      }
+      int ii = i & 0xff;
+      int jj = j & 0xff;
+      int kk = k & 0xff;
+
+      cx[0] = x0;
+      cy[0] = y0;
+      cz[0] = z0;
+      cx[1] = x0 - i1 + G3;
+      cy[1] = y0 - j1 + G3;
+      cz[1] = z0 - k1 + G3;
+      cx[2] = x0 - i2 + 2.0f * G3;
+      cy[2] = y0 - j2 + 2.0f * G3;
+      cz[2] = z0 - k2 + 2.0f * G3;
+      cx[3] = x0 - 1.0f + 3.0f * G3;
+      cy[3] = y0 - 1.0f + 3.0f * G3;
+      cz[3] = z0 - 1.0f + 3.0f * G3;
+      h[0] = perm[ii + perm[jj + perm[kk]]];
+      h[1] = perm[ii + i1 + perm[jj + j1 + perm[kk + k1]]];
+      h[2] = perm[ii + i2 + perm[jj + j2 + perm[kk + k2]]];
+      h[3] = perm[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+
+      for( c = 0; c < 4; c++ ) {
+        int m = 4 * p + c;
+        float tc = 0.5f - cx[c]*cx[c] - cy[c]*cy[c] - cz[c]*cz[c];
+        if( tc < 0.0f ) tc = 0.0f; /* No influence */
+        sp->hash[m] = h[c] & 15;
+        sp->x[m] = cx[c];
+        sp->y[m] = cy[c];
+        sp->z[m] = cz[c];
+        sp->t3[m] = tc * tc * tc;
+        sp->t4[m] = ( tc * tc ) * ( tc * tc );
+      }
+    }
+    return 0;
+  }
+
+void srdprep3_free( srdprep3 *sp )
+  {
+    free( sp->hash );
+    free( sp->x );
+    sp->hash = 0;
+    sp->x = sp->y = sp->z = sp->t3 = sp->t4 = 0;
+  }
+
+void srdprep3_eval( const srdprep3 *sp, float angle, float *result,
+                    float *dnoise_dx, float *dnoise_dy, float *dnoise_dz )
+  {
+    srdgrad3 rg;
+    int p, c, d = dnoise_dx && dnoise_dy && dnoise_dz;
+
+    srdgrad3_set( &rg, angle );
+    for( p = 0; p < sp->n; p++ ) {
+      const unsigned char *h = sp->hash + 4 * p;
+      const float *x = sp->x + 4 * p, *y = sp->y + 4 * p, *z = sp->z + 4 * p;
+      const float *t3 = sp->t3 + 4 * p, *t4 = sp->t4 + 4 * p;
+      const float *g[4];
+      float gd[4];
+
+      for( c = 0; c < 4; c++ ) {
+        g[c] = rg.grad[h[c]];
+        gd[c] = graddotp3( g[c][0], g[c][1], g[c][2], x[c], y[c], z[c] );
+      }
+      result[p] = 72.0f * ( t4[0] * gd[0] + t4[1] * gd[1]
+                            + t4[2] * gd[2] + t4[3] * gd[3] );
+      if( d ) {
+        float temp = t3[0] * gd[0];
+        float ddx = temp * x[0], ddy = temp * y[0], ddz = temp * z[0];
+        for( c = 1; c < 4; c++ ) {
+          temp = t3[c] * gd[c];
+          ddx += temp * x[c];
+          ddy += temp * y[c];
+          ddz += temp * z[c];
+        }
+        ddx *= -8.0f;
+        ddy *= -8.0f;
+        ddz *= -8.0f;
+        ddx += t4[0] * g[0][0] + t4[1] * g[1][0] + t4[2] * g[2][0] + t4[3] * g[3][0];
+        ddy += t4[0] * g[0][1] + t4[1] * g[1][1] + t4[2] * g[2][1] + t4[3] * g[3][1];
+        ddz += t4[0] * g[0][2] + t4[1] * g[1][2] + t4[2] * g[2][2] + t4[3] * g[3][2];
+        dnoise_dx[p] = 72.0f * ddx;
+        dnoise_dy[p] = 72.0f * ddy;
+        dnoise_dz[p] = 72.0f * ddz;
+      }
+    }
+  }
+
+/* --------------------------------------------------------------------- */
+
+/*
+ * Periodic 2D noise with rotating gradients. The simplex grid of
+ * srdnoise2() never repeats along the coordinate axes, so this uses a
+ * lattice of points in rows one unit apart, with a spacing of one unit
+ * within each row and every second row offset by half a unit. Twice the
+ * x coordinate of a lattice point is always an integer, and wrapping that
+ * by twice the period before hashing makes points one period apart get
+ * the same gradient.
+ */
+
+static int pwrap( int i, int p ) {
+    if( p <= 0 ) return i; /* No period along this axis */
+    i %= p;
+    return ( i < 0 ) ? i + p : i;
+}
+
+/* Contribution from the corner at offset (x,y) with the lattice point at
+ * (i - j/2, j). The derivative is added to (*dx,*dy).
+ */
+static float prcorner2( float x, float y, int i, int j, int px, int py,
+                        float sin_t, float cos_t, float *dx, float *dy ) {
+    float gx, gy, t, t2, t4, gdotp;
+    int x2;
+
+    /* The kernel is as wide as it can be without reaching beyond the
+     * corners of the triangle that the point is in. */
+    t = 0.8f - x * x - y * y;
+    if( t < 0.0f ) return 0.0f; /* No influence */
+    x2 = pwrap( 2 * i - j, 2 * px );
+    j = pwrap( j, py );
+    i = ( x2 + j ) >> 1;
+    gradrot2( perm[( i & 0xff ) + perm[j & 0xff]], sin_t, cos_t, &gx, &gy );
+    t2 = t * t;
+    t4 = t2 * t2;
+    gdotp = graddotp2( gx, gy, x, y );
+    *dx += -8.0f * t2 * t * gdotp * x + t4 * gx;
+    *dy += -8.0f * t2 * t * gdotp * y + t4 * gy;
+    return t4 * gdotp;
+}
+
+/** 2D periodic simplex noise with rotating gradients.
+ * If the last two arguments are not null, the analytic derivative
+ * (the 2D gradient of the total noise field) is also calculated.
+ */
+float psrdnoise2( float x, float y, float angle, int px, int py,
+                  float *dnoise_dx, float *dnoise_dy )
+  {
+    float dx = 0.0f, dy = 0.0f;
+    float sin_t = sin( angle );
+    float cos_t = cos( angle );
+
+    py += py & 1; /* The rows only repeat every second row */
+
+    /* Skew the input space so that the lattice points are at integer (u,v) */
+    float u = x + 0.5f * y;
+    int i = FASTFLOOR( u );
+    int j = FASTFLOOR( y );
+    float fu = u - i;
+    float fv = y - j;
+
+    /* The cell is split into two triangles along its diagonal */
+    int i1, j1;
+    if( fu > fv ) { i1 = 1; j1 = 0; }
+    else { i1 = 0; j1 = 1; }
+
+    float x0 = x - ( i - 0.5f * j ); /* Offsets from the first corner */
+    float y0 = fv;
+    float noise = prcorner2( x0, y0, i, j, px, py, sin_t, cos_t, &dx, &dy )
+                + prcorner2( x0 - i1 + 0.5f * j1, y0 - j1, i + i1, j + j1,
+                             px, py, sin_t, cos_t, &dx, &dy )
+                + prcorner2( x0 - 0.5f, y0 - 1.0f, i + 1, j + 1,
+                             px, py, sin_t, cos_t, &dx, &dy );
+
+    /* The largest value over all angles is close to 0.129 (empirically
+     * determined), and the result is scaled to fit within [-1,1]. */
+    if( ( dnoise_dx ) && ( dnoise_dy ) )
+      {
+        *dnoise_dx = 7.7f * dx;
+        *dnoise_dy = 7.7f * dy;
+      }
+    return 7.7f * noise;
+  }
@@ -42,6 +42,24 @@
  *
  */
 
+/**
+ * Rotated gradient tables for one fixed angle, for evaluating many samples
+ * at the same angle, such as all the pixels of one animation frame.
+ * srdgrad2_set() and srdgrad3_set() rotate the gradients once, and
+ * srdnoise2_rot() and srdnoise3_rot() then only look them up, which skips
+ * the trigonometry and the rotation at every corner of every sample. The
+ * values are the same as from srdnoise2() and srdnoise3() with that angle.
+ */
+typedef struct {
+  float angle;        /* Rotation angle of the table */
+  float grad[8][2];   /* Rotated gradients, indexed by the low hash bits */
+} srdgrad2;
+
+typedef struct {
+  float angle;
+  float grad[16][3];
+} srdgrad3;
+
 /**
  * Simplex, rotating, derivative noise over 2 dimensions
  */
@@ -52,3 +70,58 @@ float srdnoise2( float x, float y, float t, float *dnoise_dx, float *dnoise_dy )
  */
 float srdnoise3( float x, float y, float z, float t, float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
 
+
+/**
+ * Prepared sample sets, for animating the noise at fixed points such as
+ * mesh vertices or pixel grids, where only the angle changes from frame
+ * to frame. srdprep2_init() and srdprep3_init() store the simplex corner
+ * offsets, falloff weights and gradient indices of the n points once, and
+ * srdprep2_eval() and srdprep3_eval() then evaluate all of the points at
+ * one angle with only a table lookup and a dot product per corner.
+ * result[i] and the derivatives of point i are the same as from
+ * srdnoise2() and srdnoise3() at that angle, and the derivative arrays may
+ * be null. The init functions return 0 on success, -1 if out of memory.
+ */
+typedef struct {
+  int n;               /* Number of points */
+  unsigned char *hash; /* Gradient index of corner c of point i at [3*i+c] */
+  float *x, *y;        /* Offsets from the corners, indexed the same way */
+  float *t3, *t4;      /* Falloff weights, 0 for corners without influence */
+} srdprep2;
+
+typedef struct {
+  int n;
+  unsigned char *hash; /* Corner c of point i at [4*i+c] */
+  float *x, *y, *z;
+  float *t3, *t4;
+} srdprep3;
+
+int srdprep2_init( srdprep2 *sp, int n, const float *x, const float *y );
+void srdprep2_free( srdprep2 *sp );
+void srdprep2_eval( const srdprep2 *sp, float t, float *result, float *dnoise_dx, float *dnoise_dy );
+
+int srdprep3_init( srdprep3 *sp, int n, const float *x, const float *y, const float *z );
+void srdprep3_free( srdprep3 *sp );
+void srdprep3_eval( const srdprep3 *sp, float t, float *result, float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+
+/**
+ * Periodic simplex, rotating, derivative noise over 2 dimensions, which
+ * tiles with an integer period px, py along each axis. A period of 0 means
+ * no wrapping along that axis. The lattice is not the same as for
+ * srdnoise2(), and it only repeats every second unit along y, so an odd
+ * py is rounded up to the next even number.
+ */
+float psrdnoise2( float x, float y, float t, int px, int py, float *dnoise_dx, float *dnoise_dy );
+
+void srdgrad2_set( srdgrad2 *rg, float angle );
+void srdgrad3_set( srdgrad3 *rg, float angle );
+
+float srdnoise2_rot( const srdgrad2 *rg, float x, float y, float *dnoise_dx, float *dnoise_dy );
+float srdnoise3_rot( const srdgrad3 *rg, float x, float y, float z, float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );
+
+/**
+ * Rotating noise at one angle over arrays of n points. The derivative
+ * arrays may be null, in which case only result[] is computed.
+ */
+void srdnoise2_rot_batch( const srdgrad2 *rg, int n, const float *x, const float *y, float *result, float *dnoise_dx, float *dnoise_dy );
+void srdnoise3_rot_batch( const srdgrad3 *rg, int n, const float *x, const float *y, const float *z, float *result, float *dnoise_dx, float *dnoise_dy, float *dnoise_dz );